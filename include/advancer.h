@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "enums.h"
+#include "frozenSquares.h"
 #include "move.h"
 #include "piece.h"
 #include "position.h"
@@ -27,6 +28,8 @@ class Advancer {
 
 public:
     static void enumerateMoves(const Position &position, std::vector<Move> &moves);
+    // Skips the moves that displace frozen pieces
+    static void enumeratePrunedMoves(const Position &position, std::vector<Move> &moves, const FrozenSquares &frozen);
     static void advance(Position &position, const Move &move);
 };
 
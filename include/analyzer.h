@@ -14,12 +14,13 @@ class Analyzer {
     static bool isRangeEmpty(const Position &position, Square square, int fileStep, int rankStep, int max);
     static bool isAttackingAsRook(const Position &position, const Piece &piece, int fileDelta, int rankDelta);
     static bool isAttackingAsBishop(const Position &position, const Piece &piece, int fileDelta, int rankDelta);
-    static bool isAttacking(const Position &position, const Piece &piece, const Square &square);
 
 public:
+    static bool isAttacking(const Position &position, const Piece &piece, const Square &square);
     static void getLegalMoves(const Position &position, std::vector<Move> &moves, bool returnJustFirst = false);
     static bool isUnderAttack(const Position &position, Sides side, const Square &square);
     static bool isInCheck(const Position &position, Sides side);
+    static void getCheckers(const Position &position, Sides side, std::vector<Piece> &checkers);
     static bool isInCheck(const Position &position);
     static bool isCheckmated(const Position &position);
     static bool isInCastlingPosition(const Position &position, Sides side, CastlingSides castlingSide,
@@ -0,0 +1,23 @@
+#ifndef CHASS_ANCESTOR_COLLECTOR_H
+#define CHASS_ANCESTOR_COLLECTOR_H
+
+#include "position.h"
+#include "positionChain.h"
+#include "progressReporter.h"
+#include "searcher.h"
+
+class AncestorCollector : Searcher {
+    void (*ancestorCallback)(const Position &, long long pathCount);
+
+    void iterate(PositionChain &chain, int currentStage, int totalStages);
+    void report(const PositionChain &chain);
+
+public:
+    AncestorCollector(void (*ancestorCallback)(const Position &, long long pathCount), ProgressReporter &reporter);
+    using Searcher::getSolutionCount;
+    using Searcher::setLimits;
+    using Searcher::isComplete;
+    void search(const Position &position, int depth);
+};
+
+#endif // CHASS_ANCESTOR_COLLECTOR_H
\ No newline at end of file
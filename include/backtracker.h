@@ -1,18 +1,44 @@
 #ifndef CHASS_BACKTRACKER_H
 #define CHASS_BACKTRACKER_H
 
+#include <cstddef>
+#include <unordered_map>
 #include <vector>
 
+#include "enums.h"
 #include "move.h"
 #include "position.h"
 #include "searcher.h"
+#include "square.h"
 
 class Backtracker : Searcher {
     int fullExaminationDepth, totalDepth;
-    bool backtrack(const Position &position, std::vector<Move> &moves, std::vector<std::pair<int, int>> &progress);
+    int graphNodes;
+    bool lazyUncaptures = false;
+    std::vector<std::unordered_map<PackedPosition, long long>> countCache; // Per depth, only used when counting
+    std::unordered_map<PackedPosition, int> failureCache; // The smallest proof budget known to be insufficient
+
+    long long backtrack(const Position &position, std::vector<Move> &moves,
+                        std::vector<std::pair<int, int>> &progress, int &nodeId);
+    [[nodiscard]] int collectUncaptureKinds(const std::vector<Move> &retractMoves, std::size_t &index) const;
+    static void resolveUncapture(Position &position, const Square &square, Pieces kind);
+    long long backtrackWildcard(const Position &position, std::vector<Move> &moves,
+                                std::vector<std::pair<int, int>> &progress, int kinds, std::size_t uncaptureIndex);
+    bool prove(const Position &position, std::vector<Move> &moves, int budget,
+               std::vector<std::pair<int, int>> &progress, Position &start, bool &reachedStart);
+    bool deepen(const Position &position, std::vector<Move> &moves, std::vector<std::pair<int, int>> &progress,
+                Position &start);
+    int outputProofLine(const Position &position, const std::vector<Move> &moves, std::size_t base);
 
 public:
     using Searcher::Searcher;
+    using Searcher::setGraphCallbacks;
+    using Searcher::setCountOnly;
+    using Searcher::getSolutionCount;
+    using Searcher::setLimits;
+    using Searcher::isComplete;
+    // Uncaptured pieces are kept as wildcards until their kind matters; graph output always resolves them immediately
+    void setLazyUncaptures(bool lazyUncaptures);
     void search(const Position &position, int fullExaminationDepth, int totalDepth);
 };
 
@@ -0,0 +1,37 @@
+#ifndef CHASS_BITBOARD_BATCH_H
+#define CHASS_BITBOARD_BATCH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "enums.h"
+#include "move.h"
+#include "position.h"
+#include "square.h"
+
+// Positions laid out as bitboards indexed by file and rank, each kind of bitboard stored contiguously for the whole
+// batch, so that a kernel processes as many positions at once as fit in a vector register
+class BitboardBatch {
+    std::size_t size = 0, paddedSize = 0; // Padded to whole vectors; the padding has no king, so it is never exposed
+    std::vector<uint64_t> bitboards; // Indexed by the kind of bitboard and then by position
+
+    typedef std::array<std::array<uint64_t, 6>, 2> PieceBitboards; // Indexed by side and kind of piece
+
+    void resize(std::size_t newSize);
+    static void setSquare(PieceBitboards &pieces, const Position &position, const Square &square);
+    void store(std::size_t index, const PieceBitboards &pieces, Sides turn);
+
+public:
+    static bool isVectorized(); // Whether the processor runs the vectorized kernels
+    void assign(const std::vector<Position> &positions);
+    // The same as assign for the children reached from the parent by the moves, but faster, since only the squares
+    // changed by every move are laid out anew
+    void assignChildren(const Position &parent, const std::vector<Move> &moves, const std::vector<Position> &children);
+    // Whether the side to move attacks the other king, which is exactly when Validator::validateChecks fails. The
+    // vectorized kernel is only used when requested and supported, and gives the same results as the scalar one
+    void findExposedKings(std::vector<bool> &exposed, bool vectorized = true) const;
+};
+
+#endif // CHASS_BITBOARD_BATCH_H
\ No newline at end of file
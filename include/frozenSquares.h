@@ -0,0 +1,28 @@
+#ifndef CHASS_FROZEN_SQUARES_H
+#define CHASS_FROZEN_SQUARES_H
+
+#include <cstdint>
+
+#include "move.h"
+#include "piece.h"
+#include "position.h"
+#include "square.h"
+
+// Squares whose pieces have stayed in place throughout any game leading to the target position
+class FrozenSquares {
+    uint64_t mask = 0;
+
+    static uint64_t getBit(const Square &square);
+    static bool canLeave(const Piece &piece, uint64_t blockers);
+
+public:
+    [[nodiscard]] bool contains(const Square &square) const;
+    [[nodiscard]] uint64_t getMask() const;
+    [[nodiscard]] bool allowsRetraction(const Move &move) const;
+    [[nodiscard]] bool allowsAdvance(const Move &move) const;
+    [[nodiscard]] FrozenSquares intersectedWith(const FrozenSquares &other) const; // Frozen for both targets
+    FrozenSquares() = default;
+    explicit FrozenSquares(const Position &target);
+};
+
+#endif // CHASS_FROZEN_SQUARES_H
\ No newline at end of file
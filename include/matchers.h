@@ -31,12 +31,14 @@ class DoubleMatcher {
 private:
     Pieces type;
     const int (*map)[8][8];
+    const int (*rightMap)[8][8]; // When not set, the left map is mirrored
     const int (*promoted)[8][8];
     int sumPromoted, totalPieces;
     int firstLeftMax, secondLeftMax, firstRightMax, secondRightMax;
     int leftIndex, rightIndex;
 public:
     DoubleMatcher(Pieces type, const int (&map)[8][8], const int (&promoted)[8][8]);
+    DoubleMatcher(Pieces type, const int (&leftMap)[8][8], const int (&rightMap)[8][8], const int (&promoted)[8][8]);
     void add(const Piece &piece);
     int count();
 };
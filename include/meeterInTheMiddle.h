@@ -1,29 +1,95 @@
 #ifndef CHASS_MEETER_IN_THE_MIDDLE_H
 #define CHASS_MEETER_IN_THE_MIDDLE_H
 
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "bitboardBatch.h"
+#include "frozenSquares.h"
 #include "move.h"
+#include "placementFilter.h"
 #include "position.h"
 #include "positionChain.h"
 #include "searcher.h"
 
+struct PlacementGroup { // Nodes of a chain level sharing the piece placement and the turn
+    std::vector<int> indices;
+    std::vector<int> variants; // For every index, the number of its flag and counter state among the ones below
+    std::vector<PackedPosition> variantKeys;
+    std::vector<Position> variantPositions; // Unpacked once the other chain meets the group
+    std::vector<std::pair<PackedPosition, std::vector<bool>>> compatibility; // Per state met in the other chain
+};
+
+struct LevelSample { // Measured on a sample of the last level of a chain
+    double childrenPerNode = 0.0, secondsPerNode = 0.0, consolidationSecondsPerNode = 0.0;
+};
+
 class MeeterInTheMiddle : Searcher {
     int depth;
+    std::vector<long long> frontSolutions, backSolutions; // Per chain node, used for graph output
+    long long reportedJoins;
+    std::vector<long long> batchSolutions; // Per target of a batch search
+    double memoryLimit = 0.0; // In bytes, zero values stand for no limit
+    bool compressLevels = false;
+    // Per number of remaining plies, the front paths met from a position; only failures are kept when enumerating
+    std::vector<std::unordered_map<PackedPosition, long long>> depthFirstCache;
+    std::size_t depthFirstCacheSize, depthFirstCacheCapacity;
 
-    void iterate(PositionChain &chain,
-                 void (*enumerate)(const Position &, std::vector<Move> &),
-                 void (*perform)(Position &, const Move &), bool validate, int currentStage, int totalStages,
-                 const Position *finalPosition = nullptr);
+    void iterate(PositionChain &chain, void (*perform)(Position &, const Move &), bool validate,
+                 int currentStage, int totalStages,
+                 const std::vector<Position> *targets = nullptr); // Forward nodes must have a target within reach
+    static bool isWithinReach(const Position &position, const std::vector<Position> &targets);
+    // The children of a node are laid out as bitboards, so that their checks are found by a vectorized kernel
+    static void expand(const PositionChain &chain, const Position &position, void (*perform)(Position &, const Move &),
+                       bool validate, const std::vector<Position> *targets, std::vector<Position> &children,
+                       BitboardBatch &bitboards, std::vector<bool> &accepted);
+    LevelSample sampleLevel(const PositionChain &chain, void (*perform)(Position &, const Move &), bool validate,
+                            const std::vector<Position> *targets = nullptr) const;
+    static double predictCost(const PositionChain &chain, const LevelSample &sample);
+    static bool chooseRetraction(const PositionChain &backChain, const LevelSample &backSample,
+                                 const PositionChain &frontChain, const LevelSample &frontSample);
     static void traverse(const PositionChain &chain, int index, std::vector<Move> &reportedMoves);
+    void reportSolution(const PositionChain &frontChain, int frontIndex, const PositionChain &backChain, int backIndex,
+                        const std::vector<Move> &middleMoves); // Retracted from the back node towards the front one
     void merge(const PositionChain &frontChain, int frontIndex, const PositionChain &backChain, int backIndex);
+    void multiplyJoin(const PositionChain &frontChain, int frontIndex, const PositionChain &backChain, int backIndex);
+    void countJoin(const PositionChain &frontChain, int frontIndex, const PositionChain &backChain, int backIndex);
+    void reportJoin(const PositionChain &frontChain, int frontIndex, const PositionChain &backChain, int backIndex);
     void consolidate(const PositionChain &frontChain, const PositionChain &backChain,
-                     int currentStage, int totalStages);
-    static double predictNextLevelSize(const PositionChain &chain);
+                     int currentStage, int totalStages,
+                     void (MeeterInTheMiddle::*join)(const PositionChain &, int, const PositionChain &, int),
+                     bool interruptible);
+    static void addToGroup(std::unordered_map<PackedPosition, PlacementGroup> &groups, PlacementFilter &filter,
+                           const PackedPosition &packed, int index);
+    long long retractDepthFirst(const PositionChain &frontChain,
+                                std::unordered_map<PackedPosition, PlacementGroup> &groups,
+                                const PlacementFilter &filter, const PositionChain &backChain, int backIndex,
+                                const Position &position, int plies, std::vector<Move> &moves);
+    void finishDepthFirst(const PositionChain &frontChain, const PositionChain &backChain, int plies,
+                          int currentStage, int totalStages);
+    static const std::vector<bool> &getCompatibility(PlacementGroup &group, const PackedPosition &packed,
+                                                     bool groupIsFront);
+    static void propagateSolutions(const PositionChain &chain, std::vector<long long> &solutions);
+    void reportGraph(const PositionChain &frontChain, const PositionChain &backChain);
 
 public:
     using Searcher::Searcher;
+    using Searcher::setGraphCallbacks;
+    using Searcher::setCountOnly;
+    using Searcher::getSolutionCount;
+    using Searcher::setLimits;
+    using Searcher::isComplete;
+    // Once the chains would outgrow the limit, the remaining plies are retracted depth-first from the back frontier
+    void setMemoryLimit(double memoryLimit);
+    // Completed levels are sorted and compressed, which takes several times less memory at the cost of some time
+    void setCompressLevels(bool compressLevels);
     void search(const Position &position, int depth);
+    // Not compatible with the graph output; the target callback is called before the solutions for every target
+    void searchBatch(const std::vector<Position> &positions, int depth,
+                     void (*targetCallback)(std::size_t target, const Position &) = nullptr);
+    [[nodiscard]] const std::vector<long long> &getBatchSolutionCounts() const;
 };
 
 #endif // CHASS_MEETER_IN_THE_MIDDLE_H
\ No newline at end of file
@@ -0,0 +1,29 @@
+#ifndef CHASS_OBSTRUCTED_MOVE_MAPS_H
+#define CHASS_OBSTRUCTED_MOVE_MAPS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "enums.h"
+#include "position.h"
+#include "square.h"
+
+// Same layout as the tables in requiredMoveMaps.h, but taking the pawns that have never moved into account
+struct MoveMaps {
+    int king[8][8];
+    int queen[8][8], queenPromoted[8][8];
+    int leftBishop[8][8], rightBishop[8][8], leftBishopPromoted[8][8], rightBishopPromoted[8][8];
+    int leftKnight[8][8], rightKnight[8][8], knightPromoted[8][8];
+    int leftRook[8][8], rightRook[8][8], rookPromoted[8][8];
+};
+
+class ObstructedMoveMaps {
+    static void computeDistances(uint64_t blockers, Pieces kind, const std::vector<Square> &sources, int initial,
+                                 int (&map)[8][8], int parity = -1);
+    static MoveMaps compute(uint64_t blockers);
+
+public:
+    static const MoveMaps &get(const Position &position, Sides side);
+};
+
+#endif // CHASS_OBSTRUCTED_MOVE_MAPS_H
\ No newline at end of file
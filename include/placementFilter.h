@@ -0,0 +1,24 @@
+#ifndef CHASS_PLACEMENT_FILTER_H
+#define CHASS_PLACEMENT_FILTER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "position.h"
+
+// A Bloom filter over packed placements: it never rejects a placement that was added and rarely accepts one that was
+// not, while being small enough to stay in the cache where a hash map lookup would not
+class PlacementFilter {
+    std::vector<uint64_t> words;
+    uint64_t wordMask;
+
+    static uint64_t mix(uint64_t value);
+    static uint64_t getBits(uint64_t hash); // The bits to set or check within the chosen word
+
+public:
+    explicit PlacementFilter(int capacity); // The expected number of added placements
+    void add(const PackedPosition &placement);
+    [[nodiscard]] bool mayContain(const PackedPosition &placement) const;
+};
+
+#endif // CHASS_PLACEMENT_FILTER_H
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef CHASS_PLANNER_H
+#define CHASS_PLANNER_H
+
+#include <vector>
+
+#include "frozenSquares.h"
+#include "position.h"
+
+enum Strategies {
+    Backtracking, MeetingInTheMiddle
+};
+
+struct Plan {
+    Strategies strategy;
+    double backtrackingNodes;
+    bool meetingApplicable;
+    double meetingNodes, meetingMemory; // The memory is in bytes
+    int meetingFrontDepth; // The number of plies advanced from the starting position
+};
+
+// Chooses the search strategy from the sizes of the search trees estimated by random walks
+class Planner {
+    static void collectChildren(const Position &position, bool forward, const Position &target,
+                                const FrozenSquares &frozen, std::vector<Position> &children);
+    static std::vector<double> estimateLevelSizes(const Position &root, int depth, bool forward,
+                                                  const Position &target, const FrozenSquares &frozen);
+
+public:
+    static bool canMeetInTheMiddle(const Position &position, int fullExaminationDepth, int proofExtraDepth);
+    // A zero memory limit stands for no limit
+    static Plan plan(const Position &position, int fullExaminationDepth, int proofExtraDepth, bool countOnly,
+                     double memoryLimit);
+};
+
+#endif // CHASS_PLANNER_H
\ No newline at end of file
@@ -23,7 +23,6 @@ class Position {
     bool halfMoveLog = false, fullMoveLog = false;
     int halfMoves = 0, fullMoves = 0;
 
-    static void updateCounts(PieceCounts &counts, const Piece &piece, bool increment = true);
     void swapPieces(std::vector<Piece> &pieces, int indexA, int indexB);
     void writeToPacked(PackedPosition &packed, int &position, int value, int bits) const;
     void writeTernaryToPacked(PackedPosition &packed, int &position, Ternary value) const;
@@ -34,7 +33,10 @@ class Position {
     void init();
 
 public:
+    static void updateCounts(PieceCounts &counts, const Piece &piece, bool increment = true);
     [[nodiscard]] bool canBeSpecializationOf(const Position &position) const;
+    // Same as above, but with the piece placements assumed to be equal
+    [[nodiscard]] bool canStateBeSpecializationOf(const Position &position) const;
     void movePiece(const Square &current, const Square &another);
     void addPiece(const Square &square, Pieces kind, Sides side);
     void removePiece(const Square &square);
@@ -67,6 +69,7 @@ public:
     [[nodiscard]] bool isPieceInSquare(const Square &square, Sides side, Pieces kind) const;
     [[nodiscard]] std::string toFENPlacement(bool includeTurn = false) const;
     [[nodiscard]] PackedPosition pack() const;
+    static PackedPosition getPackedPlacement(const PackedPosition &packed); // Only keeps the turn and the pieces
     explicit Position(const PackedPosition &packed);
     Position();
 };
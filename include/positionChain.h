@@ -1,35 +1,70 @@
 #ifndef CHASS_POSITION_CHAIN_H
 #define CHASS_POSITION_CHAIN_H
 
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "frozenSquares.h"
 #include "move.h"
 #include "position.h"
 
-struct PositionChainInfo {
-    PackedPosition position;
-    Move move;
-    int nextInChain;
-    PositionChainInfo(const PackedPosition &position, const Move &move,
-                      int nextInChain) : position(position), move(move), nextInChain(nextInChain) {}
-};
-
 struct PositionChainLevel {
     int startingIndex, length;
     PositionChainLevel(int startingIndex, int length) : startingIndex(startingIndex), length(length) {}
 };
 
-class PositionChain {
+struct CompressedLevel { // Sorted positions, every block starting with a full one followed by byte differences
+    std::vector<uint8_t> data;
+    std::vector<std::size_t> blockOffsets;
+};
+
+class PositionChain { // Stored as parallel arrays, so that scanning the positions of a level only reads positions
 private:
-    std::vector<std::vector<PositionChainInfo>> chain;
+    std::vector<std::vector<PackedPosition>> positions;
+    std::vector<std::vector<int>> parents;
+    std::vector<std::vector<uint16_t>> moveIndices; // Into the list of moves enumerated for the parent
     std::vector<PositionChainLevel> levels = {{0, 0}};
+    void (*enumerate)(const Position &, std::vector<Move> &, const FrozenSquares &);
+    FrozenSquares frozen;
+    bool merging;
+    std::vector<long long> paths; // Only maintained when merging
+    std::unordered_map<PackedPosition, int> lastLevelIndices; // Same
+    std::vector<CompressedLevel> compressedLevels; // Always a prefix of the levels
+    int compressedEnd = 0; // The first index not compressed
+    std::size_t compressedBytes = 0;
+    mutable int decodedLevel = -1, decodedBlock = -1; // Scans decode every block once
+    mutable std::vector<PackedPosition> decodedPositions;
+
+    static void toBytes(const PackedPosition &position, uint8_t *bytes);
+    static PackedPosition fromBytes(const uint8_t *bytes);
+    void compressLevel(int level);
+    template<typename T>
+    static void permute(const std::vector<std::pair<uint64_t, int>> &order, int start,
+                        std::vector<std::vector<T>> &blocks);
+    void decodeBlock(int level, int block) const;
 public:
-    void add(const PackedPosition &position, const Move &move, int nextInChain);
-    [[nodiscard]] const PositionChainInfo &get(int index) const;
+    PositionChain(void (*enumerate)(const Position &, std::vector<Move> &, const FrozenSquares &),
+                  const FrozenSquares &frozen, bool merging = false);
+    void enumerateMoves(const Position &position, std::vector<Move> &moves) const; // Children are added by index
+    void add(const PackedPosition &position, int moveIndex, int parent, long long pathCount = 1);
+    [[nodiscard]] PackedPosition getPosition(int index) const;
+    [[nodiscard]] int getParent(int index) const;
+    [[nodiscard]] Move getMove(int index) const; // Re-derived from the parent, so it should not be called in bulk
+    [[nodiscard]] long long getPaths(int index) const;
     void startNextLevel();
     [[nodiscard]] const PositionChainLevel &lastLevel() const;
     [[nodiscard]] const PositionChainLevel &secondLastLevel() const;
+    [[nodiscard]] const PositionChainLevel &getLevel(int level) const;
     [[nodiscard]] int levelCount() const;
+    [[nodiscard]] int size() const;
+    [[nodiscard]] static double getNodeBytes(bool merging); // Approximate memory taken by a node
+    [[nodiscard]] double getBytes() const;
+    // Sorts and compresses the levels added since the last call, which can no longer be extended; children added later
+    // refer to the sorted indices
+    void compress();
 };
 
 #endif // CHASS_POSITION_CHAIN_H
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef CHASS_PROOF_GAME_SOLVER_H
+#define CHASS_PROOF_GAME_SOLVER_H
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "move.h"
+#include "position.h"
+#include "searcher.h"
+
+class ProofGameSolver : Searcher {
+    int length, shortestLength;
+    std::vector<std::unordered_map<PackedPosition, long long>> countCache; // Per depth, only used when counting
+    std::unordered_map<PackedPosition, int> failureCache; // The largest number of plies known to be insufficient
+
+    long long solve(const Position &position, std::vector<Move> &moves, std::vector<std::pair<int, int>> &progress);
+
+public:
+    using Searcher::Searcher;
+    using Searcher::setCountOnly;
+    using Searcher::getSolutionCount;
+    using Searcher::setLimits;
+    using Searcher::isComplete;
+    // Looks for the shortest games leading to the position that are not longer than the given number of plies
+    void search(const Position &position, int maxLength);
+    [[nodiscard]] int getShortestLength() const; // -1 if no game has been found
+};
+
+#endif // CHASS_PROOF_GAME_SOLVER_H
\ No newline at end of file
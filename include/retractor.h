@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "enums.h"
+#include "frozenSquares.h"
 #include "move.h"
 #include "piece.h"
 #include "position.h"
@@ -33,9 +34,24 @@ class Retractor {
     static void enumeratePawnMoves(const Position &position, const Piece &piece, Ternary enPassant,
                                    std::vector<Move> &moves);
     static void enumeratePromotionMoves(const Position &position, const Piece &piece, std::vector<Move> &moves);
+    static bool canRetract(const Position &position);
+    static Ternary getPawnOrCapture(const Position &position);
+    static void enumeratePieceMoves(const Position &position, const Piece &piece, Ternary pawnOrCapture,
+                                    Ternary enPassant, std::vector<Move> &moves);
+    static bool isSliding(Pieces kind);
+    static bool isBetween(const Square &square, const Square &from, const Square &to);
+    static bool areChecksPossible(const std::vector<Piece> &checkers);
+    static bool canHaveGivenCheck(const Move &move, const Piece &checker, const Square &kingSquare);
+    static void pruneMoves(const Position &position, std::vector<Move> &moves, const FrozenSquares &frozen);
 
 public:
     static void enumerateMoves(const Position &position, std::vector<Move> &moves);
+    // Skips the retractions that could not have given the current check, that lead to positions with an exposed king
+    // or impossible piece counts, or that move frozen pieces
+    static void enumeratePrunedMoves(const Position &position, std::vector<Move> &moves, const FrozenSquares &frozen);
+    // Only the retractions of the piece in the given square
+    static void enumeratePrunedPieceMoves(const Position &position, const Square &square, std::vector<Move> &moves,
+                                          const FrozenSquares &frozen);
     static void retract(Position &position, const Move &move);
 };
 
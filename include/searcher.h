@@ -1,6 +1,9 @@
 #ifndef CHASS_SEARCHER_H
 #define CHASS_SEARCHER_H
 
+#include <chrono>
+
+#include "frozenSquares.h"
 #include "move.h"
 #include "position.h"
 #include "progressReporter.h"
@@ -8,11 +11,33 @@
 class Searcher {
 protected:
     void (*positionCallback)(const Position &, const std::vector<Move> &, int fullExaminationDepth);
+    void (*nodeCallback)(int id, const Position &, int depth, long long solutionCount, bool starting) = nullptr;
+    void (*edgeCallback)(int fromId, int toId, const Move &) = nullptr;
     ProgressReporter &reporter;
+    bool countOnly = false;
+    long long solutionCount = 0;
+    long long maxSolutions = 0, nodeLimit = 0; // Zero values stand for no limits
+    double timeLimit = 0.0;
+    long long examinedNodes = 0;
+    bool stopped = false;
+    std::chrono::steady_clock::time_point startTime;
+    FrozenSquares frozen; // Computed once from the position being searched for
+
+    [[nodiscard]] bool isGraphOutput() const;
+    void startSearch();
+    bool limitReached();
+    long long acceptSolutions(long long count);
 
 public:
     Searcher(void (*positionCallback)(const Position &, const std::vector<Move> &, int fullExaminationDepth),
              ProgressReporter &reporter);
+    void setGraphCallbacks(void (*nodeCallback)(int id, const Position &, int depth, long long solutionCount,
+                                                bool starting),
+                           void (*edgeCallback)(int fromId, int toId, const Move &));
+    void setCountOnly(bool countOnly);
+    [[nodiscard]] long long getSolutionCount() const;
+    void setLimits(long long maxSolutions, double timeLimit, long long nodeLimit);
+    [[nodiscard]] bool isComplete() const;
     ~Searcher();
 };
 
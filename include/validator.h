@@ -3,9 +3,16 @@
 
 #include <vector>
 
+#include "frozenSquares.h"
+#include "move.h"
 #include "piece.h"
 #include "pieceCounts.h"
 #include "position.h"
+#include "square.h"
+
+struct MoveParities { // Parities of the numbers of moves from every first rank square, indexed by file and square
+    int origins[8][8][8];
+};
 
 class Validator {
     static void validateUserKings(const std::vector<Piece> &pieces);
@@ -15,13 +22,31 @@ class Validator {
     static void validateUserHalfMoves(const Position &position);
     static void validateUserFullMoves(const Position &position);
     static bool validateCounts(const PieceCounts &counts);
+    static int getRequiredMoves(const Position &position, Sides side);
     static bool validateRequiredMoveNumber(const Position &position, Sides side);
+    static bool validatePawnCaptures(const Position &position, Sides side);
+    static void computeMoveParities(Pieces kind, const Square &origin, const FrozenSquares &frozen,
+                                    int (&parities)[8][8]);
+    static const MoveParities &getMoveParities(const FrozenSquares &frozen, Sides side);
+    static bool validateMoveParity(const Position &position, Sides side);
+    static int getEmptyBoardDistance(Pieces kind, const Square &from, const Square &to);
+    static int getRequiredMovesTowards(const Position &position, const Position &target, Sides side);
     static bool validateInitial(const Position &position);
+    static bool isKingExposedByRetraction(const Position &position, const Move &move);
 
 public:
     static bool validateChecks(const Position &position);
     static bool validate(const Position &position);
+    // The same as validate without validateChecks, for positions whose checks have been found in a BitboardBatch
+    static bool validateExceptChecks(const Position &position);
+    static bool validateRetraction(const Position &position, const Move &move);
+    // A lower bound on the number of plies separating the position from the initial one
+    static int getRequiredPlies(const Position &position);
+    // Whether the target can still be reached from the position in the plies between their move counters
+    static bool validateTargetDistance(const Position &position, const Position &target);
     static std::pair<bool, std::string> validateAndStrictenUserPosition(Position &position);
+    // Sets the move counter implied by the number of plies played since the starting position
+    static std::pair<bool, std::string> applyPliesPlayed(Position &position, int pliesPlayed);
 };
 
 #endif // CHASS_VALIDATOR_H
\ No newline at end of file
@@ -1,8 +1,10 @@
+#include <cstddef>
 #include <vector>
 
 #include "advancer.h"
 #include "analyzer.h"
 #include "enums.h"
+#include "frozenSquares.h"
 #include "helper.h"
 #include "move.h"
 #include "piece.h"
@@ -273,6 +275,17 @@ void Advancer::enumerateMoves(const Position &position, std::vector<Move> &moves
     }
 }
 
+void Advancer::enumeratePrunedMoves(const Position &position, std::vector<Move> &moves, const FrozenSquares &frozen) {
+    enumerateMoves(position, moves);
+    std::size_t kept = 0;
+    for (auto &move : moves) {
+        if (frozen.allowsAdvance(move)) {
+            moves[kept++] = move;
+        }
+    }
+    moves.resize(kept);
+}
+
 void Advancer::advance(Position &position, const Move &move) {
     updatePieces(position, move);
     updateCastling(position, move);
@@ -88,6 +88,16 @@ bool Analyzer::isInCheck(const Position &position, Sides side) {
     return isUnderAttack(position, side, position.getKing(side).square);
 }
 
+void Analyzer::getCheckers(const Position &position, Sides side, std::vector<Piece> &checkers) {
+    checkers.clear();
+    const Square &kingSquare = position.getKing(side).square;
+    for (auto &piece : position.getPieces(Helper::opposite(side))) {
+        if (isAttacking(position, piece, kingSquare)) {
+            checkers.emplace_back(piece);
+        }
+    }
+}
+
 bool Analyzer::isInCheck(const Position &position) {
     return isInCheck(position, position.getTurn());
 }
@@ -0,0 +1,85 @@
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ancestorCollector.h"
+#include "frozenSquares.h"
+#include "move.h"
+#include "position.h"
+#include "positionChain.h"
+#include "progressReporter.h"
+#include "retractor.h"
+#include "validator.h"
+
+AncestorCollector::AncestorCollector(void (*ancestorCallback)(const Position &, long long pathCount),
+                                     ProgressReporter &reporter)
+                                     : Searcher(nullptr, reporter), ancestorCallback(ancestorCallback) {}
+
+void AncestorCollector::iterate(PositionChain &chain, int currentStage, int totalStages) {
+    chain.startNextLevel();
+    const auto &last = chain.secondLastLevel();
+    for (int i = 0; i < last.length; ++i) {
+        int index = i + last.startingIndex;
+        reporter.reportProgress({{currentStage, totalStages}, {i, last.length}});
+        std::vector<Move> moves;
+        Position position = Position(chain.getPosition(index));
+        chain.enumerateMoves(position, moves);
+        for (std::size_t moveIndex = 0; moveIndex < moves.size(); ++moveIndex) {
+            if (limitReached()) {
+                return;
+            }
+            Position previous = position;
+            Retractor::retract(previous, moves[moveIndex]);
+            if (Validator::validate(previous)) {
+                chain.add(previous.pack(), moveIndex, index, chain.getPaths(index));
+            }
+        }
+    }
+}
+
+void AncestorCollector::report(const PositionChain &chain) {
+    // Nodes of the chain also differ by castling, en passant and move counters, which are not reported
+    const auto &level = chain.lastLevel();
+    std::unordered_map<std::string, int> ancestorIndices;
+    std::vector<std::pair<int, long long>> ancestors;
+    for (int index = level.startingIndex; index < level.startingIndex + level.length; ++index) {
+        std::string FEN = Position(chain.getPosition(index)).toFENPlacement(true);
+        auto occurrence = ancestorIndices.find(FEN);
+        if (occurrence == ancestorIndices.end()) {
+            ancestorIndices[FEN] = ancestors.size();
+            ancestors.emplace_back(index, chain.getPaths(index));
+        } else {
+            ancestors[occurrence->second].second += chain.getPaths(index);
+        }
+    }
+    for (const auto &ancestor : ancestors) {
+        if (acceptSolutions(1) == 0) {
+            break;
+        }
+        if (ancestorCallback != nullptr) {
+            ancestorCallback(Position(chain.getPosition(ancestor.first)), ancestor.second);
+        }
+    }
+}
+
+void AncestorCollector::search(const Position &position, int depth) {
+    startSearch();
+    frozen = FrozenSquares(position);
+    if (!Validator::validate(position)) {
+        return;
+    }
+    // Every level only keeps distinct positions, along with the number of paths to them
+    PositionChain chain(Retractor::enumeratePrunedMoves, frozen, true);
+    chain.add(position.pack(), 0, -1);
+    for (int iteration = 0; iteration < depth; ++iteration) {
+        if (chain.lastLevel().length == 0) {
+            return;
+        }
+        iterate(chain, iteration, depth);
+        if (stopped) { // Incomplete levels cannot be reported
+            return;
+        }
+    }
+    report(chain);
+}
\ No newline at end of file
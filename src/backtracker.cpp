@@ -1,56 +1,360 @@
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
 #include <vector>
 
 #include "analyzer.h"
 #include "backtracker.h"
+#include "enums.h"
+#include "frozenSquares.h"
+#include "helper.h"
 #include "move.h"
 #include "position.h"
 #include "retractor.h"
+#include "square.h"
 #include "validator.h"
 
-bool Backtracker::backtrack(const Position &position, std::vector<Move> &moves,
-                            std::vector<std::pair<int, int>> &progress) {
-    if (!Validator::validate(position)) {
-        return false;
+constexpr std::size_t failureCacheLimit = 1 << 20; // Keeps the memory usage of the proof phase bounded
+constexpr Pieces uncaptureKinds[] = {Queen, Rook, Bishop, Knight, Pawn}; // In the order of their enumeration
+
+long long Backtracker::backtrack(const Position &position, std::vector<Move> &moves,
+                                 std::vector<std::pair<int, int>> &progress, int &nodeId) {
+    if (limitReached()) {
+        return 0;
     }
 
     int currentDepth = moves.size();
+    // The number of solutions only depends on the position and the depth, so transpositions are counted once
+    bool memoize = countOnly && currentDepth < totalDepth;
+    PackedPosition packed;
+    if (memoize) {
+        packed = position.pack();
+        auto cached = countCache[currentDepth].find(packed);
+        if (cached != countCache[currentDepth].end()) {
+            return acceptSolutions(cached->second);
+        }
+    }
+
+    if (!Validator::validate(position)) {
+        return 0;
+    }
+
     bool fullExamination = currentDepth < fullExaminationDepth;
     bool atDeepest = currentDepth == totalDepth;
+    bool starting = false;
+    long long found = 0;
 
+    std::vector<std::pair<int, Move>> graphEdges; // Only the children that lead to solutions are kept
     if (atDeepest || Analyzer::canBeStarting(position)) {
-        positionCallback(position, moves, fullExaminationDepth);
-        if (atDeepest || !fullExamination) {
-            return true;
+        if (acceptSolutions(1) > 0) {
+            if (!isGraphOutput() && !countOnly) {
+                positionCallback(position, moves, fullExaminationDepth);
+            }
+            starting = true;
+            found = 1;
+        }
+    } else if (!fullExamination) {
+        std::size_t base = moves.size();
+        Position start;
+        if (deepen(position, moves, progress, start) && acceptSolutions(1) > 0) {
+            if (isGraphOutput() && !countOnly) {
+                graphEdges.emplace_back(outputProofLine(position, moves, base), moves[base]);
+            } else if (!countOnly) {
+                positionCallback(start, moves, fullExaminationDepth);
+            }
+            found = 1;
         }
+        moves.resize(base);
     }
 
-    bool found = false;
+    if (!stopped && fullExamination) {
+        std::vector<Move> retractMoves;
+        Retractor::enumeratePrunedMoves(position, retractMoves, frozen);
+        progress.emplace_back(std::make_pair(0, retractMoves.size()));
+        for (std::size_t index = 0; index < retractMoves.size(); ++index) {
+            const Move &retractMove = retractMoves[index];
+            reporter.reportProgress(progress);
+            Position previous = position;
+            Retractor::retract(previous, retractMove);
+            moves.emplace_back(retractMove);
+            int childId;
+            int kinds = collectUncaptureKinds(retractMoves, index);
+            long long childFound = kinds == 0 ? backtrack(previous, moves, progress, childId)
+                                              : backtrackWildcard(previous, moves, progress, kinds, moves.size() - 1);
+            moves.pop_back();
+            if (childFound > 0) {
+                found += childFound;
+                if (isGraphOutput()) {
+                    graphEdges.emplace_back(childId, retractMove);
+                }
+            }
+            if (stopped) { // Solutions found so far are still reported
+                break;
+            }
+            progress.back().first = static_cast<int>(index) + 1;
+        }
+        progress.pop_back();
+    }
+
+    if (memoize && !stopped) {
+        countCache[currentDepth][packed] = found;
+    }
+    // Nodes are written in post-order, so only the current path has to be kept in memory
+    if (found > 0 && isGraphOutput() && !countOnly) {
+        nodeId = graphNodes++;
+        nodeCallback(nodeId, position, currentDepth, found, starting);
+        for (const auto &edge : graphEdges) {
+            edgeCallback(edge.first, nodeId, edge.second);
+        }
+    }
+    return found;
+}
+
+int Backtracker::collectUncaptureKinds(const std::vector<Move> &retractMoves, std::size_t &index) const {
+    const Move &move = retractMoves[index];
+    bool corner = (move.targetSquare.file == 0 || move.targetSquare.file == 7)
+                  && (move.targetSquare.rank == 0 || move.targetSquare.rank == 7);
+    // Uncaptures in corners would affect castling rights, so they are always resolved immediately
+    if (!lazyUncaptures || isGraphOutput() || corner || (move.type != Capture && move.type != PromotionWithCapture)) {
+        return 0;
+    }
+    int kinds = 1 << move.capturedPiece;
+    std::size_t last = index;
+    while (last + 1 < retractMoves.size()) { // All the variants of an uncapture are enumerated one after another
+        const Move &next = retractMoves[last + 1];
+        if (next.type != move.type || next.piece != move.piece || next.promotedPiece != move.promotedPiece
+            || !(next.startingSquare == move.startingSquare) || !(next.targetSquare == move.targetSquare)) {
+            break;
+        }
+        kinds |= 1 << next.capturedPiece;
+        ++last;
+    }
+    if (last == index) {
+        return 0;
+    }
+    index = last;
+    return kinds;
+}
+
+void Backtracker::resolveUncapture(Position &position, const Square &square, Pieces kind) {
+    Sides side = position.getSquareInfo(square).side;
+    position.removePiece(square);
+    position.addPiece(square, kind, side);
+}
+
+long long Backtracker::backtrackWildcard(const Position &position, std::vector<Move> &moves,
+                                         std::vector<std::pair<int, int>> &progress, int kinds,
+                                         std::size_t uncaptureIndex) {
+    Square square = moves[uncaptureIndex].targetSquare;
+    Position resolved = position;
+    long long found = 0;
+    if (static_cast<int>(moves.size()) >= fullExaminationDepth) { // The proof phase only handles concrete positions
+        for (Pieces kind : uncaptureKinds) {
+            if ((kinds & (1 << kind)) == 0) {
+                continue;
+            }
+            resolveUncapture(resolved, square, kind);
+            moves[uncaptureIndex].capturedPiece = kind;
+            int nodeId;
+            found += backtrack(resolved, moves, progress, nodeId);
+            if (stopped) {
+                break;
+            }
+        }
+        return found;
+    }
+    if (limitReached()) {
+        return 0;
+    }
+
+    int validKinds = 0, validKindCount = 0;
+    for (Pieces kind : uncaptureKinds) {
+        if ((kinds & (1 << kind)) == 0) {
+            continue;
+        }
+        resolveUncapture(resolved, square, kind);
+        if (!Validator::validate(resolved)) {
+            continue;
+        }
+        validKinds |= 1 << kind;
+        ++validKindCount;
+        if (Analyzer::canBeStarting(resolved) && acceptSolutions(1) > 0) {
+            if (!countOnly) {
+                moves[uncaptureIndex].capturedPiece = kind;
+                positionCallback(resolved, moves, fullExaminationDepth);
+            }
+            ++found;
+        }
+    }
+    if (validKinds == 0 || stopped) {
+        return found;
+    }
+
+    // Retractions of other pieces do not depend on the uncaptured piece's kind, except for castling, which depends on
+    // attacked squares, so they are shared by all the kinds that are still possible. The check-based pruning depends on
+    // the kind, so only the frozen squares are applied here, and the rest is left to the validation of every kind
     std::vector<Move> retractMoves;
     Retractor::enumerateMoves(position, retractMoves);
-    progress.emplace_back(std::make_pair(0, retractMoves.size()));
+    progress.emplace_back(std::make_pair(0, retractMoves.size() + validKindCount));
     for (const auto &retractMove : retractMoves) {
+        if (retractMove.targetSquare == square || retractMove.type == KingsideCastling
+            || retractMove.type == QueensideCastling || !frozen.allowsRetraction(retractMove)) {
+            ++progress.back().first;
+            continue;
+        }
         reporter.reportProgress(progress);
         Position previous = position;
         Retractor::retract(previous, retractMove);
         moves.emplace_back(retractMove);
-        if (backtrack(previous, moves, progress)) {
-            found = true;
-        }
+        found += backtrackWildcard(previous, moves, progress, validKinds, uncaptureIndex);
         moves.pop_back();
-        if (found && !fullExamination) {
+        if (stopped) {
+            break;
+        }
+        ++progress.back().first;
+    }
+
+    for (Pieces kind : uncaptureKinds) {
+        if ((validKinds & (1 << kind)) == 0 || stopped) {
+            continue;
+        }
+        reporter.reportProgress(progress);
+        resolveUncapture(resolved, square, kind);
+        moves[uncaptureIndex].capturedPiece = kind;
+        std::vector<Move> kindMoves, kingMoves;
+        Retractor::enumeratePrunedPieceMoves(resolved, square, kindMoves, frozen);
+        Retractor::enumeratePrunedPieceMoves(resolved, resolved.getKing(Helper::opposite(resolved.getTurn())).square,
+                                             kingMoves, frozen);
+        for (const auto &kingMove : kingMoves) {
+            if (kingMove.type == KingsideCastling || kingMove.type == QueensideCastling) {
+                kindMoves.emplace_back(kingMove);
+            }
+        }
+        for (const auto &kindMove : kindMoves) {
+            Position previous = resolved;
+            Retractor::retract(previous, kindMove);
+            moves.emplace_back(kindMove);
+            int childId;
+            found += backtrack(previous, moves, progress, childId);
+            moves.pop_back();
+            if (stopped) {
+                break;
+            }
+        }
+        ++progress.back().first;
+    }
+    progress.pop_back();
+    return found;
+}
+
+bool Backtracker::prove(const Position &position, std::vector<Move> &moves, int budget,
+                        std::vector<std::pair<int, int>> &progress, Position &start, bool &reachedStart) {
+    if (limitReached() || !Validator::validate(position)) {
+        return false;
+    }
+    if (Analyzer::canBeStarting(position)) {
+        start = position;
+        reachedStart = true;
+        return true;
+    }
+    if (budget == 0) {
+        start = position;
+        return true;
+    }
+
+    PackedPosition packed = position.pack();
+    auto cached = failureCache.find(packed);
+    if (cached != failureCache.end() && cached->second <= budget) {
+        return false;
+    }
+
+    std::vector<Move> retractMoves;
+    Retractor::enumeratePrunedMoves(position, retractMoves, frozen);
+    progress.emplace_back(std::make_pair(0, retractMoves.size()));
+    for (const auto &retractMove : retractMoves) {
+        reporter.reportProgress(progress);
+        Position previous = position;
+        Retractor::retract(previous, retractMove);
+        moves.emplace_back(retractMove);
+        if (prove(previous, moves, budget - 1, progress, start, reachedStart)) {
             progress.pop_back();
             return true;
         }
+        moves.pop_back();
+        if (stopped) {
+            break;
+        }
         ++progress.back().first;
     }
     progress.pop_back();
-    return found;
+
+    if (!stopped) {
+        if (failureCache.size() >= failureCacheLimit) {
+            failureCache.clear();
+        }
+        // If there is no proof with the given budget, there is none with a bigger one either: a bigger budget cannot
+        // help after a smaller one failed, since every longer proof line starts with a shorter one
+        int &failedBudget = failureCache.try_emplace(packed, budget).first->second;
+        failedBudget = std::min(failedBudget, budget);
+    }
+    return false;
+}
+
+bool Backtracker::deepen(const Position &position, std::vector<Move> &moves,
+                         std::vector<std::pair<int, int>> &progress, Position &start) {
+    std::size_t base = moves.size();
+    int extraDepth = totalDepth - static_cast<int>(base);
+    // A proof line for a budget contains proof lines for all smaller budgets, so the first failure is final. Budgets
+    // below the distance to the initial position cannot end the search early, so deepening starts from that distance
+    int firstBudget = std::clamp(Validator::getRequiredPlies(position), 1, std::max(extraDepth, 1));
+    for (int budget = firstBudget; budget <= extraDepth; ++budget) {
+        bool reachedStart = false;
+        if (!prove(position, moves, budget, progress, start, reachedStart)) {
+            return false;
+        }
+        if (reachedStart || budget == extraDepth) {
+            return true;
+        }
+        moves.resize(base);
+    }
+    return false;
+}
+
+int Backtracker::outputProofLine(const Position &position, const std::vector<Move> &moves, std::size_t base) {
+    std::vector<Position> line = {position};
+    for (std::size_t index = base; index < moves.size(); ++index) {
+        Position previous = line.back();
+        Retractor::retract(previous, moves[index]);
+        line.emplace_back(previous);
+    }
+    int nodeId = -1;
+    for (std::size_t offset = line.size() - 1; offset > 0; --offset) {
+        int previousId = nodeId;
+        nodeId = graphNodes++;
+        nodeCallback(nodeId, line[offset], static_cast<int>(base + offset), 1, previousId == -1);
+        if (previousId != -1) {
+            edgeCallback(previousId, nodeId, moves[base + offset]);
+        }
+    }
+    return nodeId;
+}
+
+void Backtracker::setLazyUncaptures(bool lazyUncaptures) {
+    this->lazyUncaptures = lazyUncaptures;
 }
 
 void Backtracker::search(const Position &position, int fullExaminationDepth, int totalDepth) {
     this->fullExaminationDepth = fullExaminationDepth;
     this->totalDepth = totalDepth;
+    startSearch();
+    frozen = FrozenSquares(position);
+    graphNodes = 0;
+    countCache.assign(countOnly ? totalDepth : 0, {});
+    failureCache.clear();
     std::vector<Move> moves = {};
     std::vector<std::pair<int, int>> progress = {};
-    backtrack(position, moves, progress);
+    int rootId;
+    backtrack(position, moves, progress, rootId);
+    countCache.clear();
+    failureCache.clear();
 }
\ No newline at end of file
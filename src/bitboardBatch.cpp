@@ -0,0 +1,207 @@
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "bitboardBatch.h"
+#include "enums.h"
+#include "helper.h"
+#include "move.h"
+#include "piece.h"
+#include "position.h"
+#include "square.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHASS_AVX2_KERNELS // Built for every x86 processor, run only on the ones supporting AVX2
+// The kernel templates are always inlined into the AVX2 function, so vectors never cross a call
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+enum BitboardKinds {
+    Occupied, ExposedKing, // The king is the one of the side not to move
+    AttackingPawns, AttackingKnights, DiagonalSliders, StraightSliders, AttackingKing, // Of the side to move
+    WhiteToMove, // All bits set or none
+    BitboardKindCount
+};
+
+constexpr std::size_t lanes = 4; // The number of bitboards in an AVX2 register
+constexpr uint64_t firstRanks = 0x0101010101010101ULL; // The bit index is the file times eight plus the rank
+constexpr uint64_t lastRanks = firstRanks << 7;
+constexpr uint64_t notFirstRanks = ~firstRanks;
+constexpr uint64_t notLastRanks = ~lastRanks;
+constexpr uint64_t notFirstTwoRanks = ~(firstRanks | (firstRanks << 1));
+constexpr uint64_t notLastTwoRanks = ~(lastRanks | (lastRanks >> 1));
+
+// Shifts by a number of squares, eight per file and one per rank; moving across the edge of a rank wraps around,
+// which the callers mask out, while moving past the edge of a file drops the bits
+template<int delta, typename Bitboards>
+[[gnu::always_inline]] inline Bitboards shift(const Bitboards &bitboards) {
+    if constexpr (delta > 0) {
+        return bitboards << delta;
+    } else {
+        return bitboards >> -delta;
+    }
+}
+
+// The squares attacked along a line by sliders standing on the origin: the Kogge-Stone occluded fill, which takes the
+// same operations for every bitboard and so needs no branches or lookups
+template<int delta, typename Bitboards>
+[[gnu::always_inline]] inline Bitboards slide(const Bitboards &origin, const Bitboards &empty, uint64_t unwrapped) {
+    Bitboards generator = origin, propagator = empty & unwrapped;
+    generator |= propagator & shift<delta>(generator);
+    propagator &= shift<delta>(propagator);
+    generator |= propagator & shift<2 * delta>(generator);
+    propagator &= shift<2 * delta>(propagator);
+    generator |= propagator & shift<4 * delta>(generator);
+    return shift<delta>(generator) & unwrapped;
+}
+
+// Attacks are symmetric but for pawns, so the pieces attacking a king are found by attacking from the king instead;
+// nonzero bitboards are returned for exposed kings
+template<typename Bitboards>
+[[gnu::always_inline]] inline Bitboards findAttackers(const Bitboards (&bitboards)[BitboardKindCount]) {
+    const Bitboards &king = bitboards[ExposedKing], &whiteToMove = bitboards[WhiteToMove];
+    Bitboards empty = ~bitboards[Occupied];
+    Bitboards whitePawnSquares = (shift<7>(king) | shift<-9>(king)) & notLastRanks;
+    Bitboards blackPawnSquares = (shift<9>(king) | shift<-7>(king)) & notFirstRanks;
+    Bitboards pawnSquares = (whiteToMove & whitePawnSquares) | (~whiteToMove & blackPawnSquares);
+    Bitboards knightSquares = ((shift<10>(king) | shift<-6>(king)) & notFirstTwoRanks)
+                              | ((shift<6>(king) | shift<-10>(king)) & notLastTwoRanks)
+                              | ((shift<17>(king) | shift<-15>(king)) & notFirstRanks)
+                              | ((shift<15>(king) | shift<-17>(king)) & notLastRanks);
+    Bitboards kingSquares = ((shift<1>(king) | shift<9>(king) | shift<-7>(king)) & notFirstRanks)
+                            | ((shift<-1>(king) | shift<7>(king) | shift<-9>(king)) & notLastRanks)
+                            | shift<8>(king) | shift<-8>(king);
+    Bitboards diagonalSquares = slide<9>(king, empty, notFirstRanks) | slide<-7>(king, empty, notFirstRanks)
+                                | slide<7>(king, empty, notLastRanks) | slide<-9>(king, empty, notLastRanks);
+    Bitboards straightSquares = slide<1>(king, empty, notFirstRanks) | slide<-1>(king, empty, notLastRanks)
+                                | slide<8>(king, empty, ~0ULL) | slide<-8>(king, empty, ~0ULL);
+    return (pawnSquares & bitboards[AttackingPawns]) | (knightSquares & bitboards[AttackingKnights])
+           | (kingSquares & bitboards[AttackingKing]) | (diagonalSquares & bitboards[DiagonalSliders])
+           | (straightSquares & bitboards[StraightSliders]);
+}
+
+#ifdef CHASS_AVX2_KERNELS
+typedef uint64_t Vector __attribute__((vector_size(lanes * sizeof(uint64_t))));
+
+// Compiled for AVX2, where every operation of the kernel on a vector is a single instruction
+__attribute__((target("avx2"))) static void findExposedKingsAVX2(const uint64_t *bitboards, std::size_t size,
+                                                                 std::size_t paddedSize, std::vector<bool> &exposed) {
+    for (std::size_t index = 0; index < size; index += lanes) {
+        Vector vectors[BitboardKindCount];
+        for (int kind = 0; kind < BitboardKindCount; ++kind) {
+            std::memcpy(&vectors[kind], bitboards + kind * paddedSize + index, sizeof(Vector));
+        }
+        Vector attackers = findAttackers(vectors);
+        for (std::size_t lane = 0; lane < lanes && index + lane < size; ++lane) {
+            exposed[index + lane] = attackers[lane] != 0;
+        }
+    }
+}
+#endif
+
+void BitboardBatch::resize(std::size_t newSize) {
+    size = newSize;
+    paddedSize = (size + lanes - 1) / lanes * lanes;
+    bitboards.assign(BitboardKindCount * paddedSize, 0);
+}
+
+void BitboardBatch::setSquare(PieceBitboards &pieces, const Position &position, const Square &square) {
+    uint64_t bit = 1ULL << (square.file * 8 + square.rank);
+    for (auto &side : pieces) {
+        for (auto &kind : side) {
+            kind &= ~bit;
+        }
+    }
+    if (!position.isSquareEmpty(square)) {
+        const Piece &piece = position.getPiece(position.getSquareInfo(square));
+        pieces[piece.side][piece.kind] |= bit;
+    }
+}
+
+void BitboardBatch::store(std::size_t index, const PieceBitboards &pieces, Sides turn) {
+    const auto &attacking = pieces[turn];
+    uint64_t occupied = 0;
+    for (const auto &side : pieces) {
+        for (uint64_t kind : side) {
+            occupied |= kind;
+        }
+    }
+    bitboards[Occupied * paddedSize + index] = occupied;
+    bitboards[ExposedKing * paddedSize + index] = pieces[Helper::opposite(turn)][King];
+    bitboards[AttackingPawns * paddedSize + index] = attacking[Pawn];
+    bitboards[AttackingKnights * paddedSize + index] = attacking[Knight];
+    bitboards[DiagonalSliders * paddedSize + index] = attacking[Bishop] | attacking[Queen];
+    bitboards[StraightSliders * paddedSize + index] = attacking[Rook] | attacking[Queen];
+    bitboards[AttackingKing * paddedSize + index] = attacking[King];
+    bitboards[WhiteToMove * paddedSize + index] = turn == White ? ~0ULL : 0;
+}
+
+void BitboardBatch::assign(const std::vector<Position> &positions) {
+    resize(positions.size());
+    for (std::size_t index = 0; index < size; ++index) {
+        PieceBitboards pieces = {};
+        for (Sides side : {White, Black}) {
+            for (const auto &piece : positions[index].getPieces(side)) {
+                pieces[side][piece.kind] |= 1ULL << (piece.square.file * 8 + piece.square.rank);
+            }
+        }
+        store(index, pieces, positions[index].getTurn());
+    }
+}
+
+void BitboardBatch::assignChildren(const Position &parent, const std::vector<Move> &moves,
+                                   const std::vector<Position> &children) {
+    // Whether advanced or retracted, a move only changes its own two squares, the square of a pawn captured en passant
+    // and the squares of a castling rook
+    resize(children.size());
+    PieceBitboards parentPieces = {};
+    for (Sides side : {White, Black}) {
+        for (const auto &piece : parent.getPieces(side)) {
+            parentPieces[side][piece.kind] |= 1ULL << (piece.square.file * 8 + piece.square.rank);
+        }
+    }
+    for (std::size_t index = 0; index < size; ++index) {
+        const Move &move = moves[index];
+        const Position &child = children[index];
+        PieceBitboards pieces = parentPieces;
+        setSquare(pieces, child, move.startingSquare);
+        setSquare(pieces, child, move.targetSquare);
+        if (move.type == EnPassant) {
+            setSquare(pieces, child, Square(move.targetSquare.file, move.side == White ? 4 : 3));
+        } else if (move.type == KingsideCastling || move.type == QueensideCastling) {
+            bool kingside = move.type == KingsideCastling;
+            int firstRank = move.side == White ? 0 : 7;
+            setSquare(pieces, child, Square(kingside ? 7 : 0, firstRank));
+            setSquare(pieces, child, Square(kingside ? 5 : 3, firstRank));
+        }
+        store(index, pieces, child.getTurn());
+    }
+}
+
+bool BitboardBatch::isVectorized() {
+#ifdef CHASS_AVX2_KERNELS
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+void BitboardBatch::findExposedKings(std::vector<bool> &exposed, bool vectorized) const {
+    exposed.assign(size, false);
+#ifdef CHASS_AVX2_KERNELS
+    if (vectorized && isVectorized()) {
+        findExposedKingsAVX2(bitboards.data(), size, paddedSize, exposed);
+        return;
+    }
+#endif
+    for (std::size_t index = 0; index < size; ++index) {
+        uint64_t scalars[BitboardKindCount];
+        for (int kind = 0; kind < BitboardKindCount; ++kind) {
+            scalars[kind] = bitboards[kind * paddedSize + index];
+        }
+        exposed[index] = findAttackers(scalars) != 0;
+    }
+}
\ No newline at end of file
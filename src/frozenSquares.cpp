@@ -0,0 +1,103 @@
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "enums.h"
+#include "frozenSquares.h"
+#include "move.h"
+#include "piece.h"
+#include "position.h"
+#include "square.h"
+
+constexpr Pieces firstRankPieces[8] = {Rook, Knight, Bishop, Queen, King, Bishop, Knight, Rook};
+
+uint64_t FrozenSquares::getBit(const Square &square) {
+    return uint64_t(1) << (square.rank * 8 + square.file);
+}
+
+bool FrozenSquares::canLeave(const Piece &piece, uint64_t blockers) {
+    // Checking the first step in every direction is enough, as a piece cannot get any farther without making it
+    for (int fileDelta = -2; fileDelta <= 2; ++fileDelta) {
+        for (int rankDelta = -2; rankDelta <= 2; ++rankDelta) {
+            bool knightStep = abs(fileDelta * rankDelta) == 2;
+            bool unitStep = abs(fileDelta) <= 1 && abs(rankDelta) <= 1 && (fileDelta != 0 || rankDelta != 0);
+            bool straight = fileDelta == 0 || rankDelta == 0;
+            bool allowed = piece.kind == Knight ? knightStep
+                    : unitStep && (piece.kind == King || piece.kind == Queen || (piece.kind == Rook) == straight);
+            if (!allowed) {
+                continue;
+            }
+            Square next = piece.square.shift(fileDelta, rankDelta);
+            if (next.file >= 0 && next.file < 8 && next.rank >= 0 && next.rank < 8
+                && (blockers & getBit(next)) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool FrozenSquares::contains(const Square &square) const {
+    return (mask & getBit(square)) != 0;
+}
+
+uint64_t FrozenSquares::getMask() const {
+    return mask;
+}
+
+bool FrozenSquares::allowsRetraction(const Move &move) const {
+    // The retracted piece stands on the target square; castling retractions never start from an initial square
+    return !contains(move.targetSquare);
+}
+
+bool FrozenSquares::allowsAdvance(const Move &move) const {
+    if (contains(move.startingSquare) || contains(move.targetSquare)) {
+        return false;
+    }
+    if (move.type == KingsideCastling || move.type == QueensideCastling) {
+        int firstRank = move.side == White ? 0 : 7;
+        return !contains(Square(move.type == KingsideCastling ? 7 : 0, firstRank));
+    }
+    return true;
+}
+
+FrozenSquares FrozenSquares::intersectedWith(const FrozenSquares &other) const {
+    FrozenSquares result;
+    result.mask = mask & other.mask;
+    return result;
+}
+
+FrozenSquares::FrozenSquares(const Position &target) {
+    // A piece on its initial square is frozen if all of its moves are blocked by frozen pieces, as it could have
+    // neither left the square nor been replaced later on. The largest set closed under this rule is found by dropping
+    // pieces that have a way out until none is left
+    std::vector<Piece> candidates;
+    for (Sides side : {White, Black}) {
+        int firstRank = side == White ? 0 : 7;
+        int pawnRank = side == White ? 1 : 6;
+        for (auto &piece : target.getPieces(side)) {
+            if (piece.kind == Pawn && piece.square.rank == pawnRank) {
+                mask |= getBit(piece.square); // A pawn cannot return to its initial rank
+            } else if (piece.square.rank == firstRank && piece.kind == firstRankPieces[piece.square.file]) {
+                bool kingside = target.getCastling(side, Kingside) == True;
+                bool queenside = target.getCastling(side, Queenside) == True;
+                mask |= getBit(piece.square);
+                // Castling rights guarantee that the king and the rook have not moved regardless of their neighbours
+                if (!(piece.kind == King && (kingside || queenside))
+                    && !(piece.kind == Rook && (piece.square.file == 7 ? kingside : queenside))) {
+                    candidates.emplace_back(piece);
+                }
+            }
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &candidate : candidates) {
+            if (contains(candidate.square) && canLeave(candidate, mask)) {
+                mask &= ~getBit(candidate.square);
+                changed = true;
+            }
+        }
+    }
+}
\ No newline at end of file
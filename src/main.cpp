@@ -1,23 +1,47 @@
+#include <getopt.h>
+#include <iomanip>
 #include <iostream>
 #include <string>
 #include <tuple>
-#include <unistd.h>
 #include <vector>
 
 #include "advancer.h"
 #include "analyzer.h"
+#include "ancestorCollector.h"
 #include "backtracker.h"
 #include "exceptions.h"
 #include "FENParser.h"
 #include "helper.h"
 #include "meeterInTheMiddle.h"
 #include "move.h"
+#include "planner.h"
 #include "progressReporter.h"
+#include "proofGameSolver.h"
 #include "validator.h"
 
 constexpr char fullExaminationDepthFlag = 'd';
 constexpr char proofExtraDepthFlag = 'e';
 constexpr char showProgressFlag = 'r';
+constexpr char graphOutputFlag = 'g';
+constexpr char countOnlyFlag = 'c';
+constexpr char ancestorsFlag = 'a';
+constexpr char lazyUncapturesFlag = 'u';
+constexpr char shortestProofFlag = 's';
+constexpr char batchFlag = 'b';
+constexpr char pliesPlayedFlag = 'n';
+constexpr char verboseFlag = 'v';
+constexpr char planOnlyFlag = 'p';
+constexpr char maxSolutionsOption[] = "max-solutions";
+constexpr char timeLimitOption[] = "time-limit";
+constexpr char nodeLimitOption[] = "node-limit";
+constexpr char memoryLimitOption[] = "memory-limit";
+constexpr char compressLevelsOption[] = "compress-levels";
+constexpr int maxSolutionsKey = 256; // Long options are given keys that cannot clash with the characters of flags
+constexpr int timeLimitKey = 257;
+constexpr int nodeLimitKey = 258;
+constexpr int memoryLimitKey = 259;
+constexpr int compressLevelsKey = 260;
+constexpr double bytesPerMegabyte = 1024.0 * 1024.0;
 
 void output(const Position &position, const std::vector<Move> &moves, int fullExaminationDepth) {
     std::cout << position.toFENPlacement();
@@ -54,6 +78,23 @@ void output(const Position &position, const std::vector<Move> &moves, int fullEx
     std::cout << std::endl << "-----" << std::endl;
 }
 
+void outputNode(int id, const Position &position, int depth, long long solutionCount, bool starting) {
+    std::cout << "node " << id << " " << depth << " " << solutionCount << " "
+              << position.toFENPlacement(true) << (starting ? " start" : "") << std::endl;
+}
+
+void outputEdge(int fromId, int toId, const Move &move) {
+    std::cout << "edge " << fromId << " " << toId << " " << move.toLongAlgebraic() << std::endl;
+}
+
+void outputTarget(std::size_t target, const Position &position) {
+    std::cout << "target " << (target + 1) << " " << position.toFENPlacement(true) << std::endl;
+}
+
+void outputAncestor(const Position &position, long long pathCount) {
+    std::cout << position.toFENPlacement(true) << " " << pathCount << std::endl;
+}
+
 void progress(const std::vector<std::pair<int, int>> &info) {
     if (info.empty()) {
         std::cerr << "Done.";
@@ -77,29 +118,68 @@ void error(const std::string &description, const std::string &details = "") {
     }
 }
 
-bool readParams(int argc, char **argv, int &fullExaminationDepth, int &proofExtraDepth, bool &showProgress) {
-    fullExaminationDepth = proofExtraDepth = -1;
-    showProgress = false;
+struct Parameters {
+    int fullExaminationDepth = -1, proofExtraDepth = -1, pliesPlayed = -1;
+    bool showProgress = false, graphOutput = false, countOnly = false, ancestors = false, lazyUncaptures = false,
+         shortestProof = false, batch = false, verbose = false, planOnly = false, compressLevels = false;
+    long long maxSolutions = 0, nodeLimit = 0, memoryLimit = 0; // The memory limit is in megabytes
+    double timeLimit = 0.0;
+};
+
+void readLimit(const std::string &value, long long &limit, std::string &issue) {
+    try {
+        limit = std::stoll(value);
+        if (limit <= 0) {
+            issue = "Limits must be positive";
+        }
+    } catch (const std::invalid_argument &e) {
+        issue = "Limit must be an integer";
+    } catch (const std::out_of_range &e) {
+        issue = "Limit is too large";
+    }
+}
+
+bool readParams(int argc, char **argv, Parameters &params) {
     std::string issue;
+    const option longOptions[] = {
+        {maxSolutionsOption, required_argument, nullptr, maxSolutionsKey},
+        {timeLimitOption, required_argument, nullptr, timeLimitKey},
+        {nodeLimitOption, required_argument, nullptr, nodeLimitKey},
+        {memoryLimitOption, required_argument, nullptr, memoryLimitKey},
+        {compressLevelsOption, no_argument, nullptr, compressLevelsKey},
+        {nullptr, 0, nullptr, 0}
+    };
     while (true) {
         std::string description = Helper::charToString(fullExaminationDepthFlag) + ":" +
                                   Helper::charToString(proofExtraDepthFlag) + ":" +
-                                  Helper::charToString(showProgressFlag);
-        int option = getopt(argc, argv, description.c_str());
+                                  Helper::charToString(showProgressFlag) +
+                                  Helper::charToString(graphOutputFlag) +
+                                  Helper::charToString(countOnlyFlag) +
+                                  Helper::charToString(ancestorsFlag) +
+                                  Helper::charToString(lazyUncapturesFlag) +
+                                  Helper::charToString(shortestProofFlag) +
+                                  Helper::charToString(batchFlag) +
+                                  Helper::charToString(pliesPlayedFlag) + ":" +
+                                  Helper::charToString(verboseFlag) +
+                                  Helper::charToString(planOnlyFlag);
+        int option = getopt_long(argc, argv, description.c_str(), longOptions, nullptr);
         if (option == EOF) {
             break;
         }
         switch (option) {
             case fullExaminationDepthFlag:
             case proofExtraDepthFlag:
+            case pliesPlayedFlag:
                 try {
                     int value = std::stoi(optarg);
                     if (value < 0) {
                         issue = "Depth must be non-negative";
                     } else if (option == fullExaminationDepthFlag) {
-                        fullExaminationDepth = value;
+                        params.fullExaminationDepth = value;
+                    } else if (option == proofExtraDepthFlag) {
+                        params.proofExtraDepth = value;
                     } else {
-                        proofExtraDepth = value;
+                        params.pliesPlayed = value;
                     }
                 } catch (const std::invalid_argument &e) {
                     issue = "Depth must be an integer";
@@ -108,32 +188,117 @@ bool readParams(int argc, char **argv, int &fullExaminationDepth, int &proofExtr
                 }
                 break;
             case showProgressFlag:
-                showProgress = true;
+                params.showProgress = true;
+                break;
+            case graphOutputFlag:
+                params.graphOutput = true;
+                break;
+            case countOnlyFlag:
+                params.countOnly = true;
+                break;
+            case ancestorsFlag:
+                params.ancestors = true;
+                break;
+            case lazyUncapturesFlag:
+                params.lazyUncaptures = true;
+                break;
+            case shortestProofFlag:
+                params.shortestProof = true;
+                break;
+            case batchFlag:
+                params.batch = true;
+                break;
+            case verboseFlag:
+                params.verbose = true;
+                break;
+            case planOnlyFlag:
+                params.planOnly = true;
+                break;
+            case maxSolutionsKey:
+                readLimit(optarg, params.maxSolutions, issue);
+                break;
+            case nodeLimitKey:
+                readLimit(optarg, params.nodeLimit, issue);
+                break;
+            case memoryLimitKey:
+                readLimit(optarg, params.memoryLimit, issue);
+                break;
+            case compressLevelsKey:
+                params.compressLevels = true;
+                break;
+            case timeLimitKey:
+                try {
+                    params.timeLimit = std::stod(optarg);
+                    if (params.timeLimit <= 0.0) {
+                        issue = "Limits must be positive";
+                    }
+                } catch (const std::invalid_argument &e) {
+                    issue = "Time limit must be a number";
+                } catch (const std::out_of_range &e) {
+                    issue = "Time limit is too large";
+                }
                 break;
             default:
                 issue = "Unknown argument passed";
                 break;
         }
     }
-    if (issue.empty() && fullExaminationDepth < 0 && proofExtraDepth < 0) {
+    if (params.pliesPlayed >= 0 && params.fullExaminationDepth < 0 && params.proofExtraDepth < 0) {
+        params.fullExaminationDepth = params.pliesPlayed; // The whole game is reconstructed by default
+    }
+    if (issue.empty() && params.fullExaminationDepth < 0 && params.proofExtraDepth < 0) {
         issue = "At least one depth parameter must be specified";
     }
+    if (issue.empty() && params.graphOutput && params.countOnly) {
+        issue = "Graph output and counting cannot be combined";
+    }
+    if (issue.empty() && params.graphOutput && params.lazyUncaptures) {
+        issue = "Graph output and lazy uncaptures cannot be combined";
+    }
+    if (issue.empty() && params.ancestors && (params.proofExtraDepth > 0 || params.graphOutput)) {
+        issue = "Distinct positions can neither be proved nor output as a graph";
+    }
+    if (issue.empty() && params.shortestProof && (params.fullExaminationDepth < 0 || params.proofExtraDepth >= 0)) {
+        issue = "The shortest proof game search only takes the maximum length as the depth";
+    }
+    if (issue.empty() && params.shortestProof && (params.graphOutput || params.ancestors || params.lazyUncaptures)) {
+        issue = "The shortest proof game search cannot be combined with other modes";
+    }
+    if (issue.empty() && params.batch && (params.fullExaminationDepth < 0 || params.proofExtraDepth > 0)) {
+        issue = "A batch can only be searched to the full depth without proofs";
+    }
+    if (issue.empty() && params.batch && (params.graphOutput || params.ancestors || params.shortestProof)) {
+        issue = "A batch cannot be searched in other modes";
+    }
+    if (issue.empty() && params.planOnly && (params.ancestors || params.shortestProof || params.batch)) {
+        issue = "Only the search for all sequences can be planned";
+    }
     if (issue.empty()) {
-        fullExaminationDepth = std::max(0, fullExaminationDepth);
-        proofExtraDepth = std::max(0, proofExtraDepth);
+        params.fullExaminationDepth = std::max(0, params.fullExaminationDepth);
+        params.proofExtraDepth = std::max(0, params.proofExtraDepth);
         return true;
     } else {
         error(std::string("Valid usage: chass ") +
               "[-" + Helper::charToString(fullExaminationDepthFlag) + " {depth of exhaustive examination}] " +
               "[-" + Helper::charToString(proofExtraDepthFlag) + " {extra proof depth}] " +
-              "[-" + Helper::charToString(showProgressFlag) + " (report progress to stderr)]", issue);
+              "[-" + Helper::charToString(showProgressFlag) + " (report progress to stderr)] " +
+              "[-" + Helper::charToString(graphOutputFlag) + " (output solutions as a graph)] " +
+              "[-" + Helper::charToString(countOnlyFlag) + " (only output the number of solutions)] " +
+              "[-" + Helper::charToString(ancestorsFlag) + " (output distinct positions instead of sequences)] " +
+              "[-" + Helper::charToString(lazyUncapturesFlag) + " (resolve uncaptured pieces lazily)] " +
+              "[-" + Helper::charToString(shortestProofFlag) + " (find the shortest games up to the depth)] " +
+              "[-" + Helper::charToString(batchFlag) + " (read positions until the end of input)] " +
+              "[-" + Helper::charToString(pliesPlayedFlag) + " {number of plies played since the start}] " +
+              "[-" + Helper::charToString(verboseFlag) + " (report the chosen strategy to stderr)] " +
+              "[-" + Helper::charToString(planOnlyFlag) + " (only report the strategy without searching)] " +
+              "[--" + maxSolutionsOption + " {number}] [--" + timeLimitOption + " {seconds}] " +
+              "[--" + nodeLimitOption + " {number of examined positions}] " +
+              "[--" + memoryLimitOption + " {megabytes}] [--" + compressLevelsOption + "]", issue);
         return false;
     }
 }
 
-bool readPosition(Position &position) {
-    std::string input;
-    getline(std::cin, input);
+bool readPosition(std::string &input, int pliesPlayed, Position &position) {
     try {
         position = FENParser::parse(input);
     } catch (const FENParseError &e) {
@@ -142,6 +307,13 @@ bool readPosition(Position &position) {
     }
     bool valid;
     std::string issue;
+    if (pliesPlayed >= 0) {
+        std::tie(valid, issue) = Validator::applyPliesPlayed(position, pliesPlayed);
+        if (!valid) {
+            error("The position is not valid", issue);
+            return false;
+        }
+    }
     std::tie(valid, issue) = Validator::validateAndStrictenUserPosition(position);
     if (!valid) {
         error("The position is not valid", issue);
@@ -150,24 +322,143 @@ bool readPosition(Position &position) {
     return true;
 }
 
+bool readPositions(int depth, int pliesPlayed, std::vector<Position> &positions) {
+    std::string input;
+    while (getline(std::cin, input)) {
+        if (input.empty()) {
+            continue;
+        }
+        Position position;
+        if (!readPosition(input, pliesPlayed, position)) {
+            return false;
+        }
+        if (!position.getFullMoveLog() || position.getPlyCounter() != depth + 1) {
+            error("The position is not valid", "Every position in a batch must be reached in exactly the given depth");
+            return false;
+        }
+        positions.emplace_back(position);
+    }
+    return true;
+}
+
+void outputPlan(const Plan &plan) {
+    std::cerr << std::fixed << std::setprecision(0) << "Backtracking: ~" << plan.backtrackingNodes << " positions"
+              << std::endl;
+    if (plan.meetingApplicable) {
+        std::cerr << "Meet in the Middle: ~" << plan.meetingNodes << " positions, ~"
+                  << std::setprecision(1) << plan.meetingMemory / bytesPerMegabyte << " MB, " << plan.meetingFrontDepth
+                  << " plies from the start" << std::endl;
+    } else {
+        std::cerr << "Meet in the Middle: not applicable" << std::endl;
+    }
+    std::cerr << "Chosen: " << (plan.strategy == MeetingInTheMiddle ? "Meet in the Middle" : "Backtracking")
+              << std::endl;
+}
+
+Strategies chooseStrategy(const Parameters &params, const Position &position) {
+    if (!params.verbose && !Planner::canMeetInTheMiddle(position, params.fullExaminationDepth,
+                                                        params.proofExtraDepth)) {
+        return Backtracking; // No need to sample the trees
+    }
+    Plan plan = Planner::plan(position, params.fullExaminationDepth, params.proofExtraDepth, params.countOnly,
+                              static_cast<double>(params.memoryLimit) * bytesPerMegabyte);
+    if (params.verbose) {
+        outputPlan(plan);
+    }
+    return plan.strategy;
+}
+
+int searchBatch(const Parameters &params) {
+    std::vector<Position> positions;
+    if (!readPositions(params.fullExaminationDepth, params.pliesPlayed, positions)) {
+        return 1;
+    }
+    ProgressReporter reporter(params.showProgress ? progress : nullptr);
+    MeeterInTheMiddle meeterInTheMiddle(output, reporter);
+    meeterInTheMiddle.setCountOnly(params.countOnly);
+    meeterInTheMiddle.setLimits(params.maxSolutions, params.timeLimit, params.nodeLimit);
+    meeterInTheMiddle.setCompressLevels(params.compressLevels);
+    meeterInTheMiddle.searchBatch(positions, params.fullExaminationDepth,
+                                  params.countOnly ? nullptr : outputTarget);
+    if (params.countOnly) {
+        for (long long solutionCount : meeterInTheMiddle.getBatchSolutionCounts()) {
+            std::cout << solutionCount << std::endl;
+        }
+    }
+    if (!meeterInTheMiddle.isComplete()) {
+        error("The search was stopped by a limit", "The output is incomplete");
+        return 2;
+    }
+    return 0;
+}
+
 int main(int argc, char **argv) {
-    int fullExaminationDepth, proofExtraDepth;
-    bool showProgress;
-    if (!readParams(argc, argv, fullExaminationDepth, proofExtraDepth, showProgress)) {
+    Parameters params;
+    if (!readParams(argc, argv, params)) {
         return 1;
     }
+    if (params.batch) {
+        return searchBatch(params);
+    }
+    std::string input;
+    getline(std::cin, input);
     Position position;
-    if (!readPosition(position)) {
+    if (!readPosition(input, params.pliesPlayed, position)) {
         return 1;
     }
+    if (params.planOnly) {
+        outputPlan(Planner::plan(position, params.fullExaminationDepth, params.proofExtraDepth, params.countOnly,
+                                 static_cast<double>(params.memoryLimit) * bytesPerMegabyte));
+        return 0;
+    }
 
-    ProgressReporter reporter(showProgress ? progress : nullptr);
-    if (proofExtraDepth == 0 && fullExaminationDepth > 1
-        && position.getFullMoveLog() && position.getPlyCounter() == fullExaminationDepth + 1) {
+    ProgressReporter reporter(params.showProgress ? progress : nullptr);
+    long long solutionCount;
+    bool complete;
+    if (params.ancestors) {
+        AncestorCollector ancestorCollector(params.countOnly ? nullptr : outputAncestor, reporter);
+        ancestorCollector.setLimits(params.maxSolutions, params.timeLimit, params.nodeLimit);
+        ancestorCollector.search(position, params.fullExaminationDepth);
+        solutionCount = ancestorCollector.getSolutionCount();
+        complete = ancestorCollector.isComplete();
+    } else if (params.shortestProof) {
+        ProofGameSolver proofGameSolver(output, reporter);
+        proofGameSolver.setCountOnly(params.countOnly);
+        proofGameSolver.setLimits(params.maxSolutions, params.timeLimit, params.nodeLimit);
+        proofGameSolver.search(position, params.fullExaminationDepth);
+        std::cout << proofGameSolver.getShortestLength() << std::endl;
+        solutionCount = proofGameSolver.getSolutionCount();
+        complete = proofGameSolver.isComplete();
+    } else if (chooseStrategy(params, position) == MeetingInTheMiddle) {
         MeeterInTheMiddle meeterInTheMiddle(output, reporter);
-        meeterInTheMiddle.search(position, fullExaminationDepth);
+        if (params.graphOutput) {
+            meeterInTheMiddle.setGraphCallbacks(outputNode, outputEdge);
+        }
+        meeterInTheMiddle.setCountOnly(params.countOnly);
+        meeterInTheMiddle.setLimits(params.maxSolutions, params.timeLimit, params.nodeLimit);
+        meeterInTheMiddle.setMemoryLimit(static_cast<double>(params.memoryLimit) * bytesPerMegabyte);
+        meeterInTheMiddle.setCompressLevels(params.compressLevels);
+        meeterInTheMiddle.search(position, params.fullExaminationDepth);
+        solutionCount = meeterInTheMiddle.getSolutionCount();
+        complete = meeterInTheMiddle.isComplete();
     } else {
         Backtracker backtracker(output, reporter);
-        backtracker.search(position, fullExaminationDepth, fullExaminationDepth + proofExtraDepth);
+        if (params.graphOutput) {
+            backtracker.setGraphCallbacks(outputNode, outputEdge);
+        }
+        backtracker.setCountOnly(params.countOnly);
+        backtracker.setLazyUncaptures(params.lazyUncaptures);
+        backtracker.setLimits(params.maxSolutions, params.timeLimit, params.nodeLimit);
+        backtracker.search(position, params.fullExaminationDepth,
+                           params.fullExaminationDepth + params.proofExtraDepth);
+        solutionCount = backtracker.getSolutionCount();
+        complete = backtracker.isComplete();
+    }
+    if (params.countOnly) {
+        std::cout << solutionCount << std::endl;
+    }
+    if (!complete) {
+        error("The search was stopped by a limit", "The output is incomplete");
+        return 2;
     }
 }
\ No newline at end of file
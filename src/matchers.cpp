@@ -58,6 +58,7 @@ int SingleMatcher::count() {
 DoubleMatcher::DoubleMatcher(Pieces type, const int (&map)[8][8], const int (&promoted)[8][8]) {
     this->type = type;
     this->map = &map;
+    this->rightMap = nullptr;
     this->promoted = &promoted;
     sumPromoted = 0;
     totalPieces = 0;
@@ -65,6 +66,11 @@ DoubleMatcher::DoubleMatcher(Pieces type, const int (&map)[8][8], const int (&pr
     leftIndex = rightIndex = 0;
 }
 
+DoubleMatcher::DoubleMatcher(Pieces type, const int (&leftMap)[8][8], const int (&rightMap)[8][8],
+                             const int (&promoted)[8][8]) : DoubleMatcher(type, leftMap, promoted) {
+    this->rightMap = &rightMap;
+}
+
 void DoubleMatcher::add(const Piece &piece) {
     if (piece.kind != type) {
         return;
@@ -84,7 +90,8 @@ void DoubleMatcher::add(const Piece &piece) {
         secondLeftMax = leftDifference;
     }
 
-    int rightDifference = promotedValue - (*map)[rank][rightFile];
+    int rightValue = rightMap == nullptr ? (*map)[rank][rightFile] : (*rightMap)[rank][leftFile];
+    int rightDifference = promotedValue - rightValue;
     if (rightDifference > firstRightMax) {
         secondRightMax = firstRightMax;
         firstRightMax = rightDifference;
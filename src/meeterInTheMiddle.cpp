@@ -1,71 +1,185 @@
 #include <algorithm>
-#include <map>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "advancer.h"
 #include "analyzer.h"
+#include "bitboardBatch.h"
+#include "frozenSquares.h"
 #include "meeterInTheMiddle.h"
 #include "move.h"
+#include "placementFilter.h"
 #include "position.h"
 #include "positionChain.h"
 #include "retractor.h"
 #include "validator.h"
 
-void MeeterInTheMiddle::iterate(PositionChain &chain,
-                                void (*enumerate)(const Position &, std::vector<Move> &),
-                                void (*perform)(Position &, const Move &), bool validate,
-                                int currentStage, int totalStages, const Position *finalPosition) {
+constexpr int levelSampleSize = 64; // Smaller levels are measured in full
+constexpr double directionMargin = 0.25; // Relative difference of the predicted costs below which timings are ignored
+constexpr double cacheEntryBytes = sizeof(PackedPosition) + sizeof(long long) + 2 * sizeof(void*);
+
+void MeeterInTheMiddle::iterate(PositionChain &chain, void (*perform)(Position &, const Move &), bool validate,
+                                int currentStage, int totalStages, const std::vector<Position> *targets) {
     chain.startNextLevel();
     const auto &last = chain.secondLastLevel();
-    auto &next = chain.lastLevel();
+    std::vector<Position> children;
+    BitboardBatch bitboards;
+    std::vector<bool> accepted;
     for (int i = 0; i < last.length; ++i) {
         int index = i + last.startingIndex;
         reporter.reportProgress({{currentStage, totalStages}, {i, last.length}});
-        std::vector<Move> moves;
-        Position position = Position(chain.get(index).position);
-        enumerate(position, moves);
-        for (const auto &move : moves) {
-            if (finalPosition != nullptr && move.piece == Pawn
-                && ((move.side == White && move.startingSquare.rank == 1)
-                    || (move.side == Black && move.startingSquare.rank == 6))
-                && finalPosition->isPieceInSquare(move.startingSquare, move.side, move.piece)) {
-                continue;
+        expand(chain, Position(chain.getPosition(index)), perform, validate, targets, children, bitboards, accepted);
+        for (std::size_t moveIndex = 0; moveIndex < children.size(); ++moveIndex) {
+            if (limitReached()) {
+                return;
             }
-            Position nextPosition = position;
-            perform(nextPosition, move);
-            if ((validate && Validator::validate(nextPosition))
-                || (!validate && Validator::validateChecks(nextPosition))) {
-                chain.add(nextPosition.pack(), move, index);
+            if (accepted[moveIndex]) {
+                chain.add(children[moveIndex].pack(), moveIndex, index, chain.getPaths(index));
             }
         }
     }
+    if (compressLevels) {
+        chain.compress();
+    }
+}
+
+bool MeeterInTheMiddle::isWithinReach(const Position &position, const std::vector<Position> &targets) {
+    for (const auto &target : targets) {
+        if (Validator::validateTargetDistance(position, target)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MeeterInTheMiddle::expand(const PositionChain &chain, const Position &position,
+                               void (*perform)(Position &, const Move &), bool validate,
+                               const std::vector<Position> *targets, std::vector<Position> &children,
+                               BitboardBatch &bitboards, std::vector<bool> &accepted) {
+    std::vector<Move> moves;
+    chain.enumerateMoves(position, moves);
+    children.assign(moves.size(), position);
+    for (std::size_t index = 0; index < moves.size(); ++index) {
+        perform(children[index], moves[index]);
+    }
+    bitboards.assignChildren(position, moves, children);
+    bitboards.findExposedKings(accepted); // Whether every child is illegal for now, then whether it is accepted
+    for (std::size_t index = 0; index < children.size(); ++index) {
+        accepted[index] = !accepted[index]
+                          && (validate ? Validator::validateExceptChecks(children[index])
+                                       : targets == nullptr || isWithinReach(children[index], *targets));
+    }
+}
+
+LevelSample MeeterInTheMiddle::sampleLevel(const PositionChain &chain, void (*perform)(Position &, const Move &),
+                                           bool validate,
+                                           const std::vector<Position> *targets) const {
+    // Nodes are expanded exactly as by iterate, so that the sample reflects the cost of validation in each direction
+    LevelSample sample;
+    const auto &last = chain.lastLevel();
+    int sampleSize = std::min(last.length, levelSampleSize);
+    if (sampleSize == 0) {
+        return sample;
+    }
+    std::vector<int> indices;
+    for (int item = 0; item < sampleSize; ++item) {
+        indices.emplace_back(last.startingIndex + static_cast<int>(static_cast<long long>(item) * last.length
+                                                                   / sampleSize));
+    }
+    long long children = 0;
+    auto expansionStart = std::chrono::steady_clock::now();
+    std::vector<Position> batch;
+    BitboardBatch bitboards;
+    std::vector<bool> accepted;
+    for (int index : indices) {
+        expand(chain, Position(chain.getPosition(index)), perform, validate, targets, batch, bitboards, accepted);
+        children += std::count(accepted.begin(), accepted.end(), true);
+    }
+    auto consolidationStart = std::chrono::steady_clock::now();
+    std::unordered_map<PackedPosition, int> placements; // The grouping done by consolidate for every node
+    for (int index : indices) {
+        ++placements[Position::getPackedPlacement(chain.getPosition(index))];
+    }
+    auto end = std::chrono::steady_clock::now();
+    sample.childrenPerNode = static_cast<double>(children) / sampleSize;
+    sample.secondsPerNode = std::chrono::duration<double>(consolidationStart - expansionStart).count() / sampleSize;
+    sample.consolidationSecondsPerNode = std::chrono::duration<double>(end - consolidationStart).count() / sampleSize;
+    return sample;
+}
+
+double MeeterInTheMiddle::predictCost(const PositionChain &chain, const LevelSample &sample) {
+    // Expanding the last level now, plus the least that will be done with the next one: grouping it on consolidation
+    auto length = static_cast<double>(chain.lastLevel().length);
+    return length * sample.secondsPerNode + length * sample.childrenPerNode * sample.consolidationSecondsPerNode;
 }
 
 void MeeterInTheMiddle::traverse(const PositionChain &chain, int index, std::vector<Move> &reportedMoves) {
     for (int level = chain.levelCount() - 1; level > 0; --level) {
-        auto &current = chain.get(index);
-        reportedMoves.emplace_back(current.move);
-        index = current.nextInChain;
+        reportedMoves.emplace_back(chain.getMove(index));
+        index = chain.getParent(index);
     }
 }
 
-void MeeterInTheMiddle::merge(const PositionChain &frontChain, int frontIndex,
-                              const PositionChain &backChain, int backIndex) {
+void MeeterInTheMiddle::reportSolution(const PositionChain &frontChain, int frontIndex,
+                                       const PositionChain &backChain, int backIndex,
+                                       const std::vector<Move> &middleMoves) {
+    if (acceptSolutions(1) == 0) {
+        return;
+    }
     std::vector<Move> reportedMoves;
     reportedMoves.reserve(depth);
     traverse(backChain, backIndex, reportedMoves);
     std::reverse(reportedMoves.begin(), reportedMoves.end());
+    reportedMoves.insert(reportedMoves.end(), middleMoves.begin(), middleMoves.end());
     traverse(frontChain, frontIndex, reportedMoves);
     positionCallback(Analyzer::getStartingPosition(), reportedMoves, depth);
 }
 
+void MeeterInTheMiddle::merge(const PositionChain &frontChain, int frontIndex,
+                              const PositionChain &backChain, int backIndex) {
+    reportSolution(frontChain, frontIndex, backChain, backIndex, {});
+}
+
+void MeeterInTheMiddle::multiplyJoin(const PositionChain &frontChain, int frontIndex,
+                                     const PositionChain &backChain, int backIndex) {
+    acceptSolutions(frontChain.getPaths(frontIndex) * backChain.getPaths(backIndex));
+}
+
+void MeeterInTheMiddle::countJoin(const PositionChain &, int frontIndex, const PositionChain &, int backIndex) {
+    if (acceptSolutions(1) == 0) {
+        return;
+    }
+    ++frontSolutions[frontIndex];
+    ++backSolutions[backIndex];
+}
+
+void MeeterInTheMiddle::reportJoin(const PositionChain &frontChain, int frontIndex,
+                                   const PositionChain &backChain, int backIndex) {
+    if (reportedJoins++ >= solutionCount) { // Pairs are visited in the same order as when counting
+        return;
+    }
+    if (frontChain.levelCount() > 1) { // Otherwise the back node is the starting position itself
+        edgeCallback(backChain.size() + frontChain.getParent(frontIndex), backIndex, frontChain.getMove(frontIndex));
+    }
+}
+
 void MeeterInTheMiddle::consolidate(const PositionChain &frontChain, const PositionChain &backChain,
-                                    int currentStage, int totalStages) {
+                                    int currentStage, int totalStages,
+                                    void (MeeterInTheMiddle::*join)(const PositionChain &, int,
+                                                                    const PositionChain &, int),
+                                    bool interruptible) {
     const auto &frontLevel = frontChain.lastLevel();
     const auto &backLevel = backChain.lastLevel();
     int totalSteps = frontLevel.length + backLevel.length;
     int currentStep = 0;
-    std::map<std::string, std::vector<int>> positionMap;
+    // Placements are matched first, so the flags and counters are only compared once per pair of distinct states. Only
+    // the join is collapsed: nodes differing in their flags alone are still stored and expanded separately, as they are
+    // by the other searchers
+    std::unordered_map<PackedPosition, PlacementGroup> groups;
     std::vector<std::pair<const PositionChain*, const PositionChainLevel*>> chains;
     int frontThenBack = frontLevel.length < backLevel.length;
     if (frontThenBack) {
@@ -73,26 +187,28 @@ void MeeterInTheMiddle::consolidate(const PositionChain &frontChain, const Posit
     } else {
         chains = {{&backChain, &backLevel}, {&frontChain, &frontLevel}};
     }
+    PlacementFilter filter(chains[0].second->length); // Most nodes of the larger level meet no group
     for (int stage = 0; stage < 2; ++stage) {
         int maxIndex = chains[stage].second->startingIndex + chains[stage].second->length;
         for (int index = chains[stage].second->startingIndex; index < maxIndex; ++index) {
+            if (interruptible && (stopped || limitReached())) {
+                return;
+            }
             reporter.reportProgress({{currentStage, totalStages}, {currentStep, totalSteps}});
-            std::string FEN = Position(chains[stage].first->get(index).position).toFENPlacement();
-            auto occurrence = positionMap.find(FEN);
+            const PackedPosition &packed = chains[stage].first->getPosition(index);
             if (stage == 0) {
-                if (occurrence == positionMap.end()) {
-                    positionMap[FEN] = {index};
-                } else {
-                    occurrence->second.emplace_back(index);
-                }
+                addToGroup(groups, filter, packed, index);
             } else {
-                if (occurrence != positionMap.end()) {
-                    for (auto &anotherIndex : occurrence->second) {
-                        int frontIndex = frontThenBack ? anotherIndex : index;
-                        int backIndex = frontThenBack ? index : anotherIndex;
-                        if (Position(frontChain.get(frontIndex).position).canBeSpecializationOf(
-                                Position(backChain.get(backIndex).position))) {
-                            merge(frontChain, frontIndex, backChain, backIndex);
+                PackedPosition placement = Position::getPackedPlacement(packed);
+                auto occurrence = filter.mayContain(placement) ? groups.find(placement) : groups.end();
+                if (occurrence != groups.end()) {
+                    PlacementGroup &group = occurrence->second;
+                    const std::vector<bool> &compatible = getCompatibility(group, packed, frontThenBack);
+                    for (std::size_t item = 0; item < group.indices.size(); ++item) {
+                        if (compatible[group.variants[item]]) {
+                            int frontIndex = frontThenBack ? group.indices[item] : index;
+                            int backIndex = frontThenBack ? index : group.indices[item];
+                            (this->*join)(frontChain, frontIndex, backChain, backIndex);
                         }
                     }
                 }
@@ -102,33 +218,307 @@ void MeeterInTheMiddle::consolidate(const PositionChain &frontChain, const Posit
     }
 }
 
-double MeeterInTheMiddle::predictNextLevelSize(const PositionChain &chain) {
-    if (chain.levelCount() < 2) {
-        return 1.0;
+void MeeterInTheMiddle::addToGroup(std::unordered_map<PackedPosition, PlacementGroup> &groups,
+                                   PlacementFilter &filter, const PackedPosition &packed, int index) {
+    PackedPosition placement = Position::getPackedPlacement(packed);
+    filter.add(placement);
+    PlacementGroup &group = groups[placement];
+    auto variant = std::find(group.variantKeys.begin(), group.variantKeys.end(), packed);
+    if (variant == group.variantKeys.end()) {
+        group.variantKeys.emplace_back(packed);
+        variant = group.variantKeys.end() - 1;
+    }
+    group.indices.emplace_back(index);
+    group.variants.emplace_back(variant - group.variantKeys.begin());
+}
+
+long long MeeterInTheMiddle::retractDepthFirst(const PositionChain &frontChain,
+                                               std::unordered_map<PackedPosition, PlacementGroup> &groups,
+                                               const PlacementFilter &filter,
+                                               const PositionChain &backChain, int backIndex,
+                                               const Position &position, int plies, std::vector<Move> &moves) {
+    PackedPosition packed = position.pack();
+    long long met = 0;
+    if (plies == 0) {
+        PackedPosition placement = Position::getPackedPlacement(packed);
+        auto occurrence = filter.mayContain(placement) ? groups.find(placement) : groups.end();
+        if (occurrence == groups.end()) {
+            return 0;
+        }
+        PlacementGroup &group = occurrence->second;
+        const std::vector<bool> &compatible = getCompatibility(group, packed, true);
+        for (std::size_t item = 0; item < group.indices.size() && !stopped; ++item) {
+            if (compatible[group.variants[item]]) {
+                met += frontChain.getPaths(group.indices[item]);
+                if (!countOnly) {
+                    reportSolution(frontChain, group.indices[item], backChain, backIndex, moves);
+                }
+            }
+        }
+        return met;
+    }
+    auto &cache = depthFirstCache[plies];
+    auto cached = cache.find(packed);
+    if (cached != cache.end()) {
+        return cached->second;
+    }
+    std::vector<Move> retractions;
+    Retractor::enumeratePrunedMoves(position, retractions, frozen);
+    for (const auto &move : retractions) {
+        if (stopped || limitReached()) {
+            return met;
+        }
+        Position previous = position;
+        Retractor::retract(previous, move);
+        if (Validator::validate(previous)) {
+            moves.emplace_back(move);
+            met += retractDepthFirst(frontChain, groups, filter, backChain, backIndex, previous, plies - 1, moves);
+            moves.pop_back();
+        }
+    }
+    if (!stopped && (countOnly || met == 0) && depthFirstCacheCapacity > 0) {
+        if (depthFirstCacheSize == depthFirstCacheCapacity) { // The cache is only kept within the memory limit
+            for (auto &levelCache : depthFirstCache) {
+                levelCache.clear();
+            }
+            depthFirstCacheSize = 0;
+        }
+        cache.emplace(packed, met);
+        ++depthFirstCacheSize;
+    }
+    return met;
+}
+
+void MeeterInTheMiddle::finishDepthFirst(const PositionChain &frontChain, const PositionChain &backChain, int plies,
+                                         int currentStage, int totalStages) {
+    // No more levels are stored: every path retracted from a back node is joined with the front frontier on arrival,
+    // and the memory left is given to a transposition cache
+    std::unordered_map<PackedPosition, PlacementGroup> groups;
+    const auto &frontLevel = frontChain.lastLevel();
+    PlacementFilter filter(frontLevel.length);
+    for (int index = frontLevel.startingIndex; index < frontLevel.startingIndex + frontLevel.length; ++index) {
+        addToGroup(groups, filter, frontChain.getPosition(index), index);
+    }
+    double freeBytes = memoryLimit - frontChain.getBytes() - backChain.getBytes()
+                       - frontLevel.length * PositionChain::getNodeBytes(false);
+    depthFirstCache.assign(plies + 1, {});
+    depthFirstCacheSize = 0;
+    depthFirstCacheCapacity = freeBytes > 0.0 ? static_cast<std::size_t>(freeBytes / cacheEntryBytes) : 0;
+    const auto &backLevel = backChain.lastLevel();
+    std::vector<Move> moves;
+    for (int i = 0; i < backLevel.length && !stopped; ++i) {
+        reporter.reportProgress({{currentStage, totalStages}, {i, backLevel.length}});
+        int backIndex = backLevel.startingIndex + i;
+        long long met = retractDepthFirst(frontChain, groups, filter, backChain, backIndex,
+                                          Position(backChain.getPosition(backIndex)), plies, moves);
+        if (countOnly) {
+            acceptSolutions(met * backChain.getPaths(backIndex));
+        }
+    }
+    depthFirstCache.clear();
+}
+
+const std::vector<bool> &MeeterInTheMiddle::getCompatibility(PlacementGroup &group, const PackedPosition &packed,
+                                                             bool groupIsFront) {
+    for (auto &known : group.compatibility) {
+        if (known.first == packed) {
+            return known.second;
+        }
     }
-    auto lastLevelSize = static_cast<double>(chain.lastLevel().length);
-    return lastLevelSize * lastLevelSize / chain.secondLastLevel().length;
+    if (group.variantPositions.empty()) { // Most groups are never met by the other chain, so they are unpacked lazily
+        for (const auto &key : group.variantKeys) {
+            group.variantPositions.emplace_back(Position(key));
+        }
+    }
+    Position position(packed);
+    std::vector<bool> compatible;
+    for (auto &variant : group.variantPositions) {
+        compatible.emplace_back(groupIsFront ? variant.canStateBeSpecializationOf(position)
+                                             : position.canStateBeSpecializationOf(variant));
+    }
+    group.compatibility.emplace_back(packed, compatible);
+    return group.compatibility.back().second;
+}
+
+void MeeterInTheMiddle::propagateSolutions(const PositionChain &chain, std::vector<long long> &solutions) {
+    for (int level = chain.levelCount() - 1; level > 0; --level) {
+        const auto &current = chain.getLevel(level);
+        for (int index = current.startingIndex; index < current.startingIndex + current.length; ++index) {
+            solutions[chain.getParent(index)] += solutions[index];
+        }
+    }
+}
+
+void MeeterInTheMiddle::reportGraph(const PositionChain &frontChain, const PositionChain &backChain) {
+    // Back nodes keep their chain indices as identifiers, front nodes are numbered after them. The meeting level is
+    // represented by the back nodes only, the front moves leading to it are reported during the second consolidation
+    int meetingLevel = backChain.levelCount() - 1;
+    for (int level = 0; level <= meetingLevel; ++level) {
+        const auto &current = backChain.getLevel(level);
+        for (int index = current.startingIndex; index < current.startingIndex + current.length; ++index) {
+            if (backSolutions[index] > 0) {
+                nodeCallback(index, Position(backChain.getPosition(index)), level, backSolutions[index],
+                             level == meetingLevel && frontChain.levelCount() == 1);
+            }
+        }
+    }
+    for (int level = 0; level < frontChain.levelCount() - 1; ++level) {
+        const auto &current = frontChain.getLevel(level);
+        for (int index = current.startingIndex; index < current.startingIndex + current.length; ++index) {
+            if (frontSolutions[index] > 0) {
+                nodeCallback(backChain.size() + index, Position(frontChain.getPosition(index)), depth - level,
+                             frontSolutions[index], level == 0);
+            }
+        }
+    }
+    for (int index = backChain.getLevel(0).length; index < backChain.size(); ++index) {
+        if (backSolutions[index] > 0) {
+            edgeCallback(index, backChain.getParent(index), backChain.getMove(index));
+        }
+    }
+    for (int level = 1; level < frontChain.levelCount() - 1; ++level) {
+        const auto &current = frontChain.getLevel(level);
+        for (int index = current.startingIndex; index < current.startingIndex + current.length; ++index) {
+            if (frontSolutions[index] > 0) {
+                edgeCallback(backChain.size() + frontChain.getParent(index), backChain.size() + index,
+                             frontChain.getMove(index));
+            }
+        }
+    }
+}
+
+bool MeeterInTheMiddle::chooseRetraction(const PositionChain &backChain, const LevelSample &backSample,
+                                         const PositionChain &frontChain, const LevelSample &frontSample) {
+    double backCost = predictCost(backChain, backSample);
+    double frontCost = predictCost(frontChain, frontSample);
+    if (std::abs(backCost - frontCost) > directionMargin * std::max(backCost, frontCost)) {
+        return backCost < frontCost;
+    }
+    // Close timings vary from run to run, so the choice falls back to the sizes of the next levels, which do not
+    double backNodes = backSample.childrenPerNode * backChain.lastLevel().length;
+    double frontNodes = frontSample.childrenPerNode * frontChain.lastLevel().length;
+    return backNodes <= frontNodes;
 }
 
 void MeeterInTheMiddle::search(const Position &position, int depth) {
     this->depth = depth;
-    PositionChain frontChain, backChain;
-    frontChain.add(Analyzer::getStartingPosition().pack(), Move(), -1);
+    startSearch();
+    frozen = FrozenSquares(position);
+    std::vector<Position> targets = {position};
+    // When counting, transpositions are merged level-wise
+    PositionChain frontChain(Advancer::enumeratePrunedMoves, frozen, countOnly);
+    PositionChain backChain(Retractor::enumeratePrunedMoves, frozen, countOnly);
+    frontChain.add(Analyzer::getStartingPosition().pack(), 0, -1);
     if (Validator::validate(position)) {
-        backChain.add(position.pack(), Move(), -1);
+        backChain.add(position.pack(), 0, -1);
     }
-    int totalStages = depth + 1; // +1 is the consolidation
+    bool graphOutput = isGraphOutput() && !countOnly;
+    int totalStages = depth + (graphOutput ? 2 : 1); // The consolidation is run twice for the graph output
     int iteration = 0;
     while (iteration < depth) {
         if (backChain.lastLevel().length == 0) {
             return;
         }
-        if (predictNextLevelSize(backChain) < predictNextLevelSize(frontChain)) { // Retracting
-            iterate(backChain, Retractor::enumerateMoves, Retractor::retract, true, iteration, totalStages);
+        LevelSample backSample = sampleLevel(backChain, Retractor::retract, true);
+        LevelSample frontSample = sampleLevel(frontChain, Advancer::advance, false, &targets);
+        bool retracting = chooseRetraction(backChain, backSample, frontChain, frontSample);
+        const PositionChain &grownChain = retracting ? backChain : frontChain;
+        double nextLevelBytes = (retracting ? backSample : frontSample).childrenPerNode * grownChain.lastLevel().length
+                                * PositionChain::getNodeBytes(countOnly);
+        if (memoryLimit > 0.0 && frontChain.getBytes() + backChain.getBytes() + nextLevelBytes > memoryLimit) {
+            if (graphOutput) { // Paths found depth-first have no nodes to be reported
+                stopped = true;
+            } else {
+                finishDepthFirst(frontChain, backChain, depth - iteration, iteration, totalStages);
+            }
+            return;
+        }
+        if (retracting) {
+            iterate(backChain, Retractor::retract, true, iteration, totalStages);
         } else { // Advancing
-            iterate(frontChain, Advancer::enumerateMoves, Advancer::advance, false, iteration, totalStages, &position);
+            iterate(frontChain, Advancer::advance, false, iteration, totalStages, &targets);
+        }
+        if (stopped) {
+            return;
         }
         ++iteration;
     }
-    consolidate(frontChain, backChain, totalStages - 1, totalStages);
+    if (countOnly) {
+        consolidate(frontChain, backChain, totalStages - 1, totalStages, &MeeterInTheMiddle::multiplyJoin, true);
+    } else if (graphOutput) {
+        frontSolutions.assign(frontChain.size(), 0);
+        backSolutions.assign(backChain.size(), 0);
+        consolidate(frontChain, backChain, totalStages - 2, totalStages, &MeeterInTheMiddle::countJoin, true);
+        propagateSolutions(frontChain, frontSolutions);
+        propagateSolutions(backChain, backSolutions);
+        reportGraph(frontChain, backChain);
+        reportedJoins = 0;
+        consolidate(frontChain, backChain, totalStages - 1, totalStages, &MeeterInTheMiddle::reportJoin, false);
+    } else {
+        consolidate(frontChain, backChain, totalStages - 1, totalStages, &MeeterInTheMiddle::merge, true);
+    }
+}
+
+void MeeterInTheMiddle::setMemoryLimit(double memoryLimit) {
+    this->memoryLimit = memoryLimit;
+}
+
+void MeeterInTheMiddle::setCompressLevels(bool compressLevels) {
+    this->compressLevels = compressLevels;
+}
+
+void MeeterInTheMiddle::searchBatch(const std::vector<Position> &positions, int depth,
+                                    void (*targetCallback)(std::size_t target, const Position &)) {
+    // The forward chain does not depend on the target, so it is built once and joined with every backward chain. As
+    // its cost is shared by the whole batch, the front advances over the larger half of the plies
+    this->depth = depth;
+    startSearch();
+    batchSolutions.assign(positions.size(), 0);
+    if (positions.empty()) {
+        return;
+    }
+    int frontDepth = depth - depth / 2;
+    int totalStages = frontDepth + static_cast<int>(positions.size()) * (depth - frontDepth + 1);
+    int stage = 0;
+    frozen = FrozenSquares(positions[0]);
+    for (const auto &position : positions) {
+        frozen = frozen.intersectedWith(FrozenSquares(position));
+    }
+    PositionChain frontChain(Advancer::enumeratePrunedMoves, frozen, countOnly);
+    frontChain.add(Analyzer::getStartingPosition().pack(), 0, -1);
+    for (int iteration = 0; iteration < frontDepth; ++iteration) {
+        iterate(frontChain, Advancer::advance, false, stage++, totalStages, &positions);
+        if (stopped) {
+            return;
+        }
+    }
+    for (std::size_t target = 0; target < positions.size(); ++target) {
+        const Position &position = positions[target];
+        if (targetCallback != nullptr) {
+            targetCallback(target, position);
+        }
+        frozen = FrozenSquares(position);
+        PositionChain backChain(Retractor::enumeratePrunedMoves, frozen, countOnly);
+        if (Validator::validate(position)) {
+            backChain.add(position.pack(), 0, -1);
+        }
+        long long previousSolutions = solutionCount;
+        for (int iteration = frontDepth; iteration < depth && backChain.lastLevel().length > 0 && !stopped;
+             ++iteration) {
+            iterate(backChain, Retractor::retract, true, stage++, totalStages);
+        }
+        if (backChain.lastLevel().length > 0 && !stopped) {
+            consolidate(frontChain, backChain, stage, totalStages,
+                        countOnly ? &MeeterInTheMiddle::multiplyJoin : &MeeterInTheMiddle::merge, true);
+        }
+        stage = frontDepth + static_cast<int>(target + 1) * (depth - frontDepth + 1);
+        batchSolutions[target] = solutionCount - previousSolutions;
+        if (stopped) {
+            return;
+        }
+    }
+}
+
+const std::vector<long long> &MeeterInTheMiddle::getBatchSolutionCounts() const {
+    return batchSolutions;
 }
\ No newline at end of file
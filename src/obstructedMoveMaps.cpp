@@ -0,0 +1,114 @@
+#include <cstdint>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "enums.h"
+#include "obstructedMoveMaps.h"
+#include "position.h"
+#include "square.h"
+
+constexpr int unreachable = 100; // Large enough to fail any move number check, yet safe to sum up
+constexpr int promotionMoves = 5; // A pawn needs this many moves to reach the last rank
+constexpr std::size_t cacheLimit = 1 << 12;
+
+uint64_t squareBit(int file, int rank) {
+    return uint64_t(1) << (file * 8 + rank);
+}
+
+void ObstructedMoveMaps::computeDistances(uint64_t blockers, Pieces kind, const std::vector<Square> &sources,
+                                          int initial, int (&map)[8][8], int parity) {
+    // Distances are computed for ranks relative to the piece's side and stored upside down, like the static tables
+    int distances[8][8];
+    for (auto &row : distances) {
+        for (auto &distance : row) {
+            distance = unreachable;
+        }
+    }
+    std::queue<Square> queue;
+    for (auto &source : sources) {
+        distances[source.file][source.rank] = initial;
+        queue.push(source);
+    }
+    bool sliding = kind == Queen || kind == Rook || kind == Bishop;
+    while (!queue.empty()) {
+        Square square = queue.front();
+        queue.pop();
+        for (int fileDelta = -2; fileDelta <= 2; ++fileDelta) {
+            for (int rankDelta = -2; rankDelta <= 2; ++rankDelta) {
+                bool knightStep = abs(fileDelta * rankDelta) == 2;
+                bool unitStep = abs(fileDelta) <= 1 && abs(rankDelta) <= 1 && (fileDelta != 0 || rankDelta != 0);
+                bool straight = fileDelta == 0 || rankDelta == 0;
+                bool allowed = kind == Knight ? knightStep
+                        : unitStep && (kind == King || kind == Queen || (kind == Rook) == straight);
+                if (!allowed) {
+                    continue;
+                }
+                Square next = square.shift(fileDelta, rankDelta);
+                while (next.file >= 0 && next.file < 8 && next.rank >= 0 && next.rank < 8
+                       && (blockers & squareBit(next.file, next.rank)) == 0) {
+                    if (distances[next.file][next.rank] == unreachable) {
+                        distances[next.file][next.rank] = distances[square.file][square.rank] + 1;
+                        queue.push(next);
+                    }
+                    if (!sliding) {
+                        break;
+                    }
+                    next = next.shift(fileDelta, rankDelta);
+                }
+            }
+        }
+    }
+    for (int file = 0; file < 8; ++file) {
+        for (int rank = 0; rank < 8; ++rank) {
+            bool otherColor = parity >= 0 && (file + rank) % 2 != parity;
+            map[7 - rank][file] = otherColor ? -1 : distances[file][rank];
+        }
+    }
+}
+
+MoveMaps ObstructedMoveMaps::compute(uint64_t blockers) {
+    std::vector<Square> lastRank, darkLastRank, lightLastRank;
+    for (int file = 0; file < 8; ++file) {
+        lastRank.emplace_back(file, 7);
+        (file % 2 == 1 ? darkLastRank : lightLastRank).emplace_back(file, 7);
+    }
+    MoveMaps maps = {};
+    // Castling is counted as a rook's move, so the king reaches its castled squares for free
+    computeDistances(blockers, King, {Square(2, 0), Square(4, 0), Square(6, 0)}, 0, maps.king);
+    computeDistances(blockers, Queen, {Square(3, 0)}, 0, maps.queen);
+    computeDistances(blockers, Queen, lastRank, promotionMoves, maps.queenPromoted);
+    computeDistances(blockers, Bishop, {Square(2, 0)}, 0, maps.leftBishop, 0);
+    computeDistances(blockers, Bishop, {Square(5, 0)}, 0, maps.rightBishop, 1);
+    computeDistances(blockers, Bishop, darkLastRank, promotionMoves, maps.leftBishopPromoted, 0);
+    computeDistances(blockers, Bishop, lightLastRank, promotionMoves, maps.rightBishopPromoted, 1);
+    computeDistances(blockers, Knight, {Square(1, 0)}, 0, maps.leftKnight);
+    computeDistances(blockers, Knight, {Square(6, 0)}, 0, maps.rightKnight);
+    computeDistances(blockers, Knight, lastRank, promotionMoves, maps.knightPromoted);
+    computeDistances(blockers, Rook, {Square(0, 0)}, 0, maps.leftRook);
+    computeDistances(blockers, Rook, {Square(7, 0)}, 0, maps.rightRook);
+    computeDistances(blockers, Rook, lastRank, promotionMoves, maps.rookPromoted);
+    return maps;
+}
+
+const MoveMaps &ObstructedMoveMaps::get(const Position &position, Sides side) {
+    static std::unordered_map<uint64_t, MoveMaps> cache;
+    // Pawns in their initial squares have never moved, so no piece has ever passed through these squares
+    uint64_t blockers = 0;
+    for (auto pawnSide : {White, Black}) {
+        int initialRank = pawnSide == White ? 1 : 6;
+        for (auto &piece : position.getPieces(pawnSide)) {
+            if (piece.kind == Pawn && piece.square.rank == initialRank) {
+                blockers |= squareBit(piece.square.file, side == White ? initialRank : 7 - initialRank);
+            }
+        }
+    }
+    auto cached = cache.find(blockers);
+    if (cached == cache.end()) {
+        if (cache.size() >= cacheLimit) {
+            cache.clear();
+        }
+        cached = cache.emplace(blockers, compute(blockers)).first;
+    }
+    return cached->second;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "placementFilter.h"
+#include "position.h"
+
+constexpr int bitsPerPlacement = 10;
+constexpr int bitIndexBits = 6;
+constexpr int bitsPerWord = 1 << bitIndexBits;
+constexpr int bitsPerLookup = 6; // All of them are set in a single word, so that a lookup reads one cache line
+
+PlacementFilter::PlacementFilter(int capacity) {
+    uint64_t wordCount = 1;
+    while (wordCount * bitsPerWord < static_cast<uint64_t>(capacity) * bitsPerPlacement) {
+        wordCount <<= 1;
+    }
+    words.assign(wordCount, 0);
+    wordMask = wordCount - 1;
+}
+
+uint64_t PlacementFilter::mix(uint64_t value) { // The SplitMix64 finalizer
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+uint64_t PlacementFilter::getBits(uint64_t hash) {
+    uint64_t bits = 0;
+    for (int lookup = 0; lookup < bitsPerLookup; ++lookup) {
+        bits |= 1ULL << ((hash >> (lookup * bitIndexBits)) & (bitsPerWord - 1));
+    }
+    return bits;
+}
+
+void PlacementFilter::add(const PackedPosition &placement) {
+    uint64_t hash = mix(std::hash<PackedPosition>()(placement));
+    words[mix(hash) & wordMask] |= getBits(hash);
+}
+
+bool PlacementFilter::mayContain(const PackedPosition &placement) const {
+    uint64_t hash = mix(std::hash<PackedPosition>()(placement));
+    uint64_t bits = getBits(hash);
+    return (words[mix(hash) & wordMask] & bits) == bits;
+}
\ No newline at end of file
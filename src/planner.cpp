@@ -0,0 +1,111 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "advancer.h"
+#include "analyzer.h"
+#include "frozenSquares.h"
+#include "move.h"
+#include "planner.h"
+#include "position.h"
+#include "positionChain.h"
+#include "retractor.h"
+#include "validator.h"
+
+constexpr int sampleCount = 64;
+constexpr std::uint_fast32_t samplingSeed = 1; // The plan should not change between runs
+// Measured relative to a chain node: a backtracked position also has its move list, caches and proof bookkeeping
+constexpr double backtrackingNodeCost = 2.5;
+
+void Planner::collectChildren(const Position &position, bool forward, const Position &target,
+                              const FrozenSquares &frozen, std::vector<Position> &children) {
+    std::vector<Move> moves;
+    if (forward) {
+        Advancer::enumeratePrunedMoves(position, moves, frozen);
+    } else {
+        Retractor::enumeratePrunedMoves(position, moves, frozen);
+    }
+    for (const auto &move : moves) {
+        Position child = position;
+        if (forward) {
+            Advancer::advance(child, move);
+            if (Validator::validateChecks(child) && Validator::validateTargetDistance(child, target)) {
+                children.emplace_back(child);
+            }
+        } else {
+            Retractor::retract(child, move);
+            if (Validator::validate(child)) {
+                children.emplace_back(child);
+            }
+        }
+    }
+}
+
+std::vector<double> Planner::estimateLevelSizes(const Position &root, int depth, bool forward,
+                                                const Position &target, const FrozenSquares &frozen) {
+    // Knuth's estimator: the product of the branching factors met along a random walk is an unbiased estimate of the
+    // size of the corresponding tree level. Transpositions are not taken into account
+    std::vector<double> sizes(depth + 1, 0.0);
+    std::mt19937 generator(samplingSeed);
+    for (int sample = 0; sample < sampleCount; ++sample) {
+        Position current = root;
+        double estimate = 1.0;
+        sizes[0] += 1.0;
+        for (int level = 1; level <= depth; ++level) {
+            std::vector<Position> children;
+            collectChildren(current, forward, target, frozen, children);
+            if (children.empty()) {
+                break;
+            }
+            estimate *= static_cast<double>(children.size());
+            sizes[level] += estimate;
+            current = children[generator() % children.size()];
+        }
+    }
+    for (auto &size : sizes) {
+        size /= sampleCount;
+    }
+    return sizes;
+}
+
+bool Planner::canMeetInTheMiddle(const Position &position, int fullExaminationDepth, int proofExtraDepth) {
+    return proofExtraDepth == 0 && fullExaminationDepth > 1
+           && position.getFullMoveLog() && position.getPlyCounter() == fullExaminationDepth + 1;
+}
+
+Plan Planner::plan(const Position &position, int fullExaminationDepth, int proofExtraDepth, bool countOnly,
+                   double memoryLimit) {
+    Plan plan{};
+    FrozenSquares frozen(position);
+    std::vector<double> backSizes = estimateLevelSizes(position, fullExaminationDepth, false, position, frozen);
+    for (double size : backSizes) {
+        plan.backtrackingNodes += size;
+    }
+    // Proofs usually succeed along the first lines tried, so they are estimated to cost one line per examined leaf
+    plan.backtrackingNodes += backSizes.back() * proofExtraDepth;
+    plan.meetingApplicable = canMeetInTheMiddle(position, fullExaminationDepth, proofExtraDepth);
+    plan.strategy = Backtracking;
+    if (!plan.meetingApplicable) {
+        return plan;
+    }
+    std::vector<double> frontSizes = estimateLevelSizes(Analyzer::getStartingPosition(), fullExaminationDepth, true,
+                                                        position, frozen);
+    double frontTotal = 0.0; // The starting position is the last level of the backward chain for the zero front depth
+    for (int frontDepth = 0; frontDepth <= fullExaminationDepth; ++frontDepth) {
+        frontTotal += frontDepth > 0 ? frontSizes[frontDepth] : 0.0;
+        double backTotal = 0.0;
+        for (int level = 0; level <= fullExaminationDepth - frontDepth; ++level) {
+            backTotal += backSizes[level];
+        }
+        if (frontDepth == 0 || frontTotal + backTotal < plan.meetingNodes) {
+            plan.meetingNodes = frontTotal + backTotal;
+            plan.meetingFrontDepth = frontDepth;
+        }
+    }
+    plan.meetingMemory = plan.meetingNodes * PositionChain::getNodeBytes(countOnly);
+    if (plan.meetingNodes <= plan.backtrackingNodes * backtrackingNodeCost
+        && (memoryLimit == 0.0 || plan.meetingMemory <= memoryLimit)) {
+        plan.strategy = MeetingInTheMiddle;
+    }
+    return plan;
+}
\ No newline at end of file
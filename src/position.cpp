@@ -9,6 +9,8 @@
 #include "position.h"
 #include "squareInfo.h"
 
+constexpr int packedPlacementBits = 1 + 64 * 4; // The turn followed by the squares
+
 void Position::updateCounts(PieceCounts &counts, const Piece &piece, bool increment) {
     int delta = increment ? 1 : -1;
     switch (piece.kind) {
@@ -45,7 +47,11 @@ void Position::swapPieces(std::vector<Piece> &pieces, int indexA, int indexB) {
 }
 
 [[nodiscard]] bool Position::canBeSpecializationOf(const Position &position) const {
-    return position.turn == turn && position.toFENPlacement() == toFENPlacement()
+    return position.toFENPlacement() == toFENPlacement() && canStateBeSpecializationOf(position);
+}
+
+[[nodiscard]] bool Position::canStateBeSpecializationOf(const Position &position) const {
+    return position.turn == turn
            && Helper::canBeSpecialization(extraInfo.whiteKingCastling, position.extraInfo.whiteKingCastling)
            && Helper::canBeSpecialization(extraInfo.whiteQueenCastling, position.extraInfo.whiteQueenCastling)
            && Helper::canBeSpecialization(extraInfo.blackKingCastling, position.extraInfo.blackKingCastling)
@@ -296,6 +302,11 @@ bool Position::readBoolFromPacked(const PackedPosition &packed, int &position) c
     return readFromPacked(packed, position, 1) == 1;
 }
 
+PackedPosition Position::getPackedPlacement(const PackedPosition &packed) {
+    static const PackedPosition mask = PackedPosition().set() >> (PackedPosition().size() - packedPlacementBits);
+    return packed & mask;
+}
+
 PackedPosition Position::pack() const {
     PackedPosition packed;
     int p = 0;
@@ -1,23 +1,95 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "frozenSquares.h"
+#include "move.h"
+#include "position.h"
 #include "positionChain.h"
 
 constexpr int blockLengthLog = 12;
 constexpr int blockLength = 1 << blockLengthLog;
 constexpr int mask = blockLength - 1;
+constexpr int packedBits = PackedPosition().size();
+constexpr int packedBytes = (packedBits + 7) / 8;
+constexpr int wordBits = 64;
+constexpr int compressedBlockLength = 32; // Random access decodes up to this many positions
+constexpr int sortedRunLength = 1 << 16;
+constexpr int maxDifferences = packedBytes / 2; // Beyond this, a position is stored in full
+constexpr uint8_t fullPositionMarker = 0xFF;
+
+PositionChain::PositionChain(void (*enumerate)(const Position &, std::vector<Move> &, const FrozenSquares &),
+                             const FrozenSquares &frozen, bool merging)
+                             : enumerate(enumerate), frozen(frozen), merging(merging) {}
+
+void PositionChain::enumerateMoves(const Position &position, std::vector<Move> &moves) const {
+    enumerate(position, moves, frozen);
+}
 
-void PositionChain::add(const PackedPosition &position, const Move &move, int nextInChain) {
-    if (chain.empty() || chain.back().size() == blockLength) {
-        chain.emplace_back();
-        chain.back().reserve(blockLength);
+void PositionChain::add(const PackedPosition &position, int moveIndex, int parent, long long pathCount) {
+    if (merging) { // Equal positions on the same level are stored once, along with the number of paths leading to them
+        auto occurrence = lastLevelIndices.find(position);
+        if (occurrence != lastLevelIndices.end()) {
+            paths[occurrence->second] += pathCount;
+            return;
+        }
+        lastLevelIndices[position] = size();
+        paths.emplace_back(pathCount);
+    }
+    if ((size() & mask) == 0) { // Compressed blocks are emptied, so their sizes cannot be relied upon
+        positions.emplace_back();
+        positions.back().reserve(blockLength);
+        parents.emplace_back();
+        parents.back().reserve(blockLength);
+        moveIndices.emplace_back();
+        moveIndices.back().reserve(blockLength);
     }
-    chain.back().emplace_back(position, move, nextInChain);
+    positions.back().emplace_back(position);
+    parents.back().emplace_back(parent);
+    moveIndices.back().emplace_back(moveIndex);
     ++levels.back().length;
 }
 
-const PositionChainInfo &PositionChain::get(int index) const {
-    return chain[index >> blockLengthLog][index & mask];
+PackedPosition PositionChain::getPosition(int index) const {
+    if (index >= compressedEnd) {
+        return positions[index >> blockLengthLog][index & mask];
+    }
+    int level = 0;
+    while (index >= levels[level].startingIndex + levels[level].length) {
+        ++level;
+    }
+    int offset = index - levels[level].startingIndex;
+    int block = offset / compressedBlockLength;
+    if (level != decodedLevel || block != decodedBlock) {
+        decodeBlock(level, block);
+    }
+    return decodedPositions[offset % compressedBlockLength];
+}
+
+int PositionChain::getParent(int index) const {
+    return parents[index >> blockLengthLog][index & mask];
+}
+
+Move PositionChain::getMove(int index) const {
+    int parent = getParent(index);
+    if (parent < 0) {
+        return Move();
+    }
+    std::vector<Move> moves;
+    enumerateMoves(Position(getPosition(parent)), moves);
+    return moves[moveIndices[index >> blockLengthLog][index & mask]];
+}
+
+long long PositionChain::getPaths(int index) const {
+    return merging ? paths[index] : 1;
 }
 
 void PositionChain::startNextLevel() {
+    lastLevelIndices.clear();
     levels.emplace_back(levels.back().startingIndex + levels.back().length, 0);
 }
 
@@ -29,6 +101,168 @@ const PositionChainLevel &PositionChain::secondLastLevel() const {
     return levels[levels.size() - 2];
 }
 
+const PositionChainLevel &PositionChain::getLevel(int level) const {
+    return levels[level];
+}
+
 int PositionChain::levelCount() const {
     return levels.size();
+}
+
+int PositionChain::size() const {
+    return levels.back().startingIndex + levels.back().length;
+}
+
+double PositionChain::getNodeBytes(bool merging) {
+    // Merging chains also store path counts and a hash map entry per node of the last level
+    constexpr double mergingBytes = sizeof(long long) + sizeof(PackedPosition) + sizeof(int) + 2 * sizeof(void*);
+    return sizeof(PackedPosition) + sizeof(int) + sizeof(uint16_t) + (merging ? mergingBytes : 0.0);
+}
+
+double PositionChain::getBytes() const {
+    return size() * getNodeBytes(merging) - compressedEnd * sizeof(PackedPosition) + compressedBytes;
+}
+
+void PositionChain::toBytes(const PackedPosition &position, uint8_t *bytes) {
+    static const PackedPosition wordMask(~0ULL);
+    for (int word = 0; word * wordBits < packedBits; ++word) {
+        unsigned long long value = ((position >> (word * wordBits)) & wordMask).to_ullong();
+        for (int byte = 0; byte < wordBits / 8 && word * wordBits / 8 + byte < packedBytes; ++byte) {
+            bytes[word * wordBits / 8 + byte] = static_cast<uint8_t>(value >> (byte * 8));
+        }
+    }
+}
+
+PackedPosition PositionChain::fromBytes(const uint8_t *bytes) {
+    PackedPosition position;
+    for (int word = 0; word * wordBits < packedBits; ++word) {
+        unsigned long long value = 0;
+        for (int byte = 0; byte < wordBits / 8 && word * wordBits / 8 + byte < packedBytes; ++byte) {
+            value |= static_cast<unsigned long long>(bytes[word * wordBits / 8 + byte]) << (byte * 8);
+        }
+        position |= PackedPosition(value) << (word * wordBits);
+    }
+    return position;
+}
+
+void PositionChain::compressLevel(int level) {
+    // Sorting brings together positions sharing the leading files, and ties keep siblings next to each other. Runs are
+    // sorted separately, so that their uncompressed blocks can be freed before the next run is sorted
+    const PositionChainLevel &current = levels[level];
+    bool remap = level + 1 < levelCount(); // Only the next level refers to this one
+    std::vector<int> newOffsets(remap ? current.length : 0);
+    CompressedLevel compressed;
+    std::array<uint8_t, packedBytes> bytes{}, previous{};
+    for (int runStart = 0; runStart < current.length; runStart += sortedRunLength) {
+        int runLength = std::min(sortedRunLength, current.length - runStart);
+        std::vector<std::pair<uint64_t, int>> keyed(runLength);
+        for (int offset = 0; offset < runLength; ++offset) {
+            toBytes(getPosition(current.startingIndex + runStart + offset), bytes.data());
+            uint64_t key = 0;
+            for (int byte = 0; byte < wordBits / 8; ++byte) {
+                key = (key << 8) | bytes[byte];
+            }
+            keyed[offset] = {key, current.startingIndex + runStart + offset};
+        }
+        std::sort(keyed.begin(), keyed.end());
+        for (int offset = 0; offset < runLength; ++offset) {
+            toBytes(getPosition(keyed[offset].second), bytes.data());
+            int differences = 0;
+            for (int byte = 0; byte < packedBytes; ++byte) {
+                differences += bytes[byte] != previous[byte] ? 1 : 0;
+            }
+            if ((runStart + offset) % compressedBlockLength == 0) {
+                compressed.blockOffsets.emplace_back(compressed.data.size());
+                compressed.data.insert(compressed.data.end(), bytes.begin(), bytes.end());
+            } else if (differences > maxDifferences) {
+                compressed.data.emplace_back(fullPositionMarker);
+                compressed.data.insert(compressed.data.end(), bytes.begin(), bytes.end());
+            } else {
+                compressed.data.emplace_back(differences);
+                for (int byte = 0; byte < packedBytes; ++byte) {
+                    if (bytes[byte] != previous[byte]) {
+                        compressed.data.emplace_back(byte);
+                        compressed.data.emplace_back(bytes[byte]);
+                    }
+                }
+            }
+            previous = bytes;
+            if (remap) {
+                newOffsets[keyed[offset].second - current.startingIndex] = runStart + offset;
+            }
+        }
+        permute(keyed, current.startingIndex + runStart, parents);
+        permute(keyed, current.startingIndex + runStart, moveIndices);
+        if (merging) {
+            std::vector<long long> sortedPaths(runLength);
+            for (int offset = 0; offset < runLength; ++offset) {
+                sortedPaths[offset] = paths[keyed[offset].second];
+            }
+            std::copy(sortedPaths.begin(), sortedPaths.end(), paths.begin() + current.startingIndex + runStart);
+        }
+        int runEnd = current.startingIndex + runStart + runLength;
+        for (std::size_t block = 0; (block + 1) * blockLength <= static_cast<std::size_t>(runEnd); ++block) {
+            std::vector<PackedPosition>().swap(positions[block]); // Earlier levels are already compressed
+        }
+    }
+    compressed.data.shrink_to_fit();
+    compressedBytes += compressed.data.size() + compressed.blockOffsets.size() * sizeof(std::size_t);
+    compressedLevels.emplace_back(std::move(compressed));
+    if (remap) {
+        const PositionChainLevel &next = levels[level + 1];
+        for (int index = next.startingIndex; index < next.startingIndex + next.length; ++index) {
+            int &parent = parents[index >> blockLengthLog][index & mask];
+            parent = current.startingIndex + newOffsets[parent - current.startingIndex];
+        }
+    }
+}
+
+template<typename T>
+void PositionChain::permute(const std::vector<std::pair<uint64_t, int>> &order, int start,
+                            std::vector<std::vector<T>> &blocks) {
+    std::vector<T> sorted(order.size());
+    for (std::size_t offset = 0; offset < order.size(); ++offset) {
+        sorted[offset] = blocks[order[offset].second >> blockLengthLog][order[offset].second & mask];
+    }
+    for (std::size_t offset = 0; offset < order.size(); ++offset) {
+        int index = start + static_cast<int>(offset);
+        blocks[index >> blockLengthLog][index & mask] = sorted[offset];
+    }
+}
+
+void PositionChain::decodeBlock(int level, int block) const {
+    const PositionChainLevel &current = levels[level];
+    const CompressedLevel &compressed = compressedLevels[level];
+    std::size_t position = compressed.blockOffsets[block];
+    std::array<uint8_t, packedBytes> bytes{};
+    decodedPositions.clear();
+    int length = std::min(compressedBlockLength, current.length - block * compressedBlockLength);
+    for (int item = 0; item < length; ++item) {
+        uint8_t differences = item == 0 ? fullPositionMarker : compressed.data[position++];
+        if (differences == fullPositionMarker) {
+            std::copy(compressed.data.begin() + position, compressed.data.begin() + position + packedBytes,
+                      bytes.begin());
+            position += packedBytes;
+        } else {
+            for (int difference = 0; difference < differences; ++difference) {
+                bytes[compressed.data[position]] = compressed.data[position + 1];
+                position += 2;
+            }
+        }
+        decodedPositions.emplace_back(fromBytes(bytes.data()));
+    }
+    decodedLevel = level;
+    decodedBlock = block;
+}
+
+void PositionChain::compress() {
+    for (int level = compressedLevels.size(); level < levelCount(); ++level) {
+        compressLevel(level);
+        compressedEnd = levels[level].startingIndex + levels[level].length;
+        decodedLevel = -1;
+    }
+    for (std::size_t block = 0; (block + 1) * blockLength <= static_cast<std::size_t>(compressedEnd); ++block) {
+        std::vector<PackedPosition>().swap(positions[block]); // Blocks partly taken by the next level are kept
+    }
+    lastLevelIndices.clear();
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "analyzer.h"
+#include "enums.h"
+#include "frozenSquares.h"
+#include "move.h"
+#include "position.h"
+#include "proofGameSolver.h"
+#include "retractor.h"
+#include "validator.h"
+
+constexpr std::size_t failureCacheLimit = 1 << 20;
+
+long long ProofGameSolver::solve(const Position &position, std::vector<Move> &moves,
+                                 std::vector<std::pair<int, int>> &progress) {
+    if (limitReached() || !Validator::validate(position)) {
+        return 0;
+    }
+    int depth = static_cast<int>(moves.size());
+    int remaining = length - depth;
+    if (Analyzer::canBeStarting(position)) {
+        // No shorter game exists, so the initial position can only be met at the very end
+        if (remaining != 0 || acceptSolutions(1) == 0) {
+            return 0;
+        }
+        if (!countOnly) {
+            positionCallback(position, moves, 0);
+        }
+        return 1;
+    }
+    if (remaining == 0 || Validator::getRequiredPlies(position) > remaining) {
+        return 0;
+    }
+
+    PackedPosition packed = position.pack();
+    if (countOnly) {
+        auto cached = countCache[depth].find(packed);
+        if (cached != countCache[depth].end()) {
+            return acceptSolutions(cached->second);
+        }
+    }
+    auto failed = failureCache.find(packed);
+    if (failed != failureCache.end() && failed->second >= remaining) {
+        return 0;
+    }
+
+    long long found = 0;
+    std::vector<Move> retractMoves;
+    Retractor::enumeratePrunedMoves(position, retractMoves, frozen);
+    progress.emplace_back(std::make_pair(0, retractMoves.size()));
+    for (const auto &retractMove : retractMoves) {
+        reporter.reportProgress(progress);
+        Position previous = position;
+        Retractor::retract(previous, retractMove);
+        moves.emplace_back(retractMove);
+        found += solve(previous, moves, progress);
+        moves.pop_back();
+        if (stopped) {
+            break;
+        }
+        ++progress.back().first;
+    }
+    progress.pop_back();
+
+    if (!stopped) {
+        if (countOnly) {
+            countCache[depth][packed] = found;
+        }
+        if (found == 0) {
+            if (failureCache.size() >= failureCacheLimit) {
+                failureCache.clear();
+            }
+            // Shorter games from here would have been found at a smaller length, so no budget up to this one suffices
+            int &failedLength = failureCache.try_emplace(packed, remaining).first->second;
+            failedLength = std::max(failedLength, remaining);
+        }
+    }
+    return found;
+}
+
+void ProofGameSolver::search(const Position &position, int maxLength) {
+    startSearch();
+    frozen = FrozenSquares(position);
+    shortestLength = -1;
+    failureCache.clear();
+    // The initial position has White to move, which fixes the parity of the length
+    int parity = position.getTurn() == White ? 0 : 1;
+    int firstLength = std::max(Validator::getRequiredPlies(position), parity);
+    int lastLength = maxLength;
+    if (position.getFullMoveLog()) {
+        firstLength = std::max(firstLength, position.getPlyCounter() - 1);
+        lastLength = std::min(lastLength, position.getPlyCounter() - 1);
+    }
+    firstLength += (firstLength - parity) % 2;
+    for (length = firstLength; length <= lastLength && !stopped; length += 2) {
+        std::vector<Move> moves = {};
+        std::vector<std::pair<int, int>> progress = {{(length - firstLength) / 2, (lastLength - firstLength) / 2 + 1}};
+        countCache.assign(countOnly ? length + 1 : 0, {});
+        if (solve(position, moves, progress) > 0) {
+            shortestLength = length;
+            break;
+        }
+    }
+    countCache.clear();
+    failureCache.clear();
+}
+
+int ProofGameSolver::getShortestLength() const {
+    return shortestLength;
+}
\ No newline at end of file
@@ -1,13 +1,17 @@
+#include <cstddef>
 #include <vector>
 
 #include "analyzer.h"
 #include "enums.h"
+#include "frozenSquares.h"
 #include "helper.h"
 #include "move.h"
 #include "piece.h"
 #include "position.h"
 #include "retractor.h"
 #include "square.h"
+#include "squareInfo.h"
+#include "validator.h"
 
 constexpr int movesBufferSize = 2500;
 
@@ -306,56 +310,162 @@ void Retractor::enumeratePromotionMoves(const Position &position, const Piece &p
     }
 }
 
+bool Retractor::isSliding(Pieces kind) {
+    return kind == Queen || kind == Rook || kind == Bishop;
+}
+
+bool Retractor::isBetween(const Square &square, const Square &from, const Square &to) {
+    int fileStep = Helper::sgn(to.file - from.file);
+    int rankStep = Helper::sgn(to.rank - from.rank);
+    for (Square current = from.shift(fileStep, rankStep); !(current == to);) {
+        if (current == square) {
+            return true;
+        }
+        current = current.shift(fileStep, rankStep);
+    }
+    return false;
+}
+
+bool Retractor::areChecksPossible(const std::vector<Piece> &checkers) {
+    if (checkers.size() > 2) {
+        return false;
+    }
+    for (auto &checker : checkers) {
+        if (checker.kind == King) {
+            return false;
+        }
+    }
+    // Only one of the checks can be given directly; any other one has to be discovered
+    return checkers.size() < 2 || isSliding(checkers[0].kind) || isSliding(checkers[1].kind);
+}
+
+bool Retractor::canHaveGivenCheck(const Move &move, const Piece &checker, const Square &kingSquare) {
+    if (checker.square == move.targetSquare) {
+        return true;
+    }
+    bool castling = move.type == KingsideCastling || move.type == QueensideCastling;
+    bool kingside = move.type == KingsideCastling;
+    int firstRank = move.side == White ? 0 : 7;
+    if (castling && checker.square == Square(kingside ? 5 : 3, firstRank)) {
+        return true;
+    }
+    if (!isSliding(checker.kind)) {
+        return false;
+    }
+    // Otherwise the check has been discovered by vacating a square on the line of attack
+    if (isBetween(move.startingSquare, checker.square, kingSquare)) {
+        return true;
+    }
+    if (move.type == EnPassant
+        && isBetween(Square(move.targetSquare.file, move.side == White ? 4 : 3), checker.square, kingSquare)) {
+        return true;
+    }
+    return castling && isBetween(Square(kingside ? 7 : 0, firstRank), checker.square, kingSquare);
+}
+
+void Retractor::pruneMoves(const Position &position, std::vector<Move> &moves, const FrozenSquares &frozen) {
+    std::vector<Piece> checkers;
+    Analyzer::getCheckers(position, position.getTurn(), checkers);
+    if (!areChecksPossible(checkers)) {
+        moves.clear();
+        return;
+    }
+    const Square &kingSquare = position.getKing(position.getTurn()).square;
+    std::size_t kept = 0;
+    for (auto &move : moves) {
+        bool viable = frozen.allowsRetraction(move);
+        for (auto &checker : checkers) {
+            if (!viable || !canHaveGivenCheck(move, checker, kingSquare)) {
+                viable = false;
+                break;
+            }
+        }
+        if (viable && Validator::validateRetraction(position, move)) {
+            moves[kept++] = move;
+        }
+    }
+    moves.resize(kept);
+}
+
+bool Retractor::canRetract(const Position &position) {
+    return !position.getFullMoveLog() || position.getFullMoveCounter() != 1 || position.getTurn() != White;
+}
+
+Ternary Retractor::getPawnOrCapture(const Position &position) {
+    return position.getHalfMoveLog() ? (position.getHalfMoveCounter() == 0 ? True : False) : Unknown;
+}
+
+void Retractor::enumeratePieceMoves(const Position &position, const Piece &piece, Ternary pawnOrCapture,
+                                    Ternary enPassant, std::vector<Move> &moves) {
+    switch (piece.kind) {
+        case King:
+            if (enPassant != True) {
+                enumerateKingMoves(position, piece, pawnOrCapture, moves);
+            }
+            break;
+        case Queen:
+            if (enPassant != True) {
+                enumerateRookLikeMoves(position, piece, pawnOrCapture, moves);
+                enumerateBishopLikeMoves(position, piece, pawnOrCapture, moves);
+            }
+            break;
+        case Rook:
+            if (enPassant != True) {
+                enumerateRookLikeMoves(position, piece, pawnOrCapture, moves);
+            }
+            break;
+        case Bishop:
+            if (enPassant != True) {
+                enumerateBishopLikeMoves(position, piece, pawnOrCapture, moves);
+            }
+            break;
+        case Knight:
+            if (enPassant != True) {
+                enumerateKnightMoves(position, piece, pawnOrCapture, moves);
+            }
+            break;
+        case Pawn:
+            if (pawnOrCapture != False) {
+                enumeratePawnMoves(position, piece, enPassant, moves);
+            }
+            break;
+    }
+    if (pawnOrCapture != False && enPassant != True) {
+        enumeratePromotionMoves(position, piece, moves);
+    }
+}
+
 void Retractor::enumerateMoves(const Position &position, std::vector<Move> &moves) {
     moves.clear();
-    if (position.getFullMoveLog() && position.getFullMoveCounter() == 1 && position.getTurn() == White) {
+    if (!canRetract(position)) {
         return;
     }
     moves.reserve(movesBufferSize);
-    const std::vector<Piece> &pieces = position.getPieces(Helper::opposite(position.getTurn()));
-    Ternary pawnOrCapture = position.getHalfMoveLog() ? (position.getHalfMoveCounter() == 0 ? True : False)
-                                                      : Unknown;
+    Ternary pawnOrCapture = getPawnOrCapture(position);
     Ternary enPassant = position.getEnPassant();
-    for (auto &piece : pieces) {
-        switch (piece.kind) {
-            case King:
-                if (enPassant != True) {
-                    enumerateKingMoves(position, piece, pawnOrCapture, moves);
-                }
-                break;
-            case Queen:
-                if (enPassant != True) {
-                    enumerateRookLikeMoves(position, piece, pawnOrCapture, moves);
-                    enumerateBishopLikeMoves(position, piece, pawnOrCapture, moves);
-                }
-                break;
-            case Rook:
-                if (enPassant != True) {
-                    enumerateRookLikeMoves(position, piece, pawnOrCapture, moves);
-                }
-                break;
-            case Bishop:
-                if (enPassant != True) {
-                    enumerateBishopLikeMoves(position, piece, pawnOrCapture, moves);
-                }
-                break;
-            case Knight:
-                if (enPassant != True) {
-                    enumerateKnightMoves(position, piece, pawnOrCapture, moves);
-                }
-                break;
-            case Pawn:
-                if (pawnOrCapture != False) {
-                    enumeratePawnMoves(position, piece, enPassant, moves);
-                }
-                break;
-        }
-        if (pawnOrCapture != False && enPassant != True) {
-            enumeratePromotionMoves(position, piece, moves);
-        }
+    for (auto &piece : position.getPieces(Helper::opposite(position.getTurn()))) {
+        enumeratePieceMoves(position, piece, pawnOrCapture, enPassant, moves);
     }
 }
 
+void Retractor::enumeratePrunedPieceMoves(const Position &position, const Square &square, std::vector<Move> &moves,
+                                          const FrozenSquares &frozen) {
+    moves.clear();
+    const SquareInfo &squareInfo = position.getSquareInfo(square);
+    if (!canRetract(position) || !squareInfo.occupied || squareInfo.side == position.getTurn()) {
+        return;
+    }
+    enumeratePieceMoves(position, position.getPiece(squareInfo), getPawnOrCapture(position), position.getEnPassant(),
+                        moves);
+    pruneMoves(position, moves, frozen);
+}
+
+void Retractor::enumeratePrunedMoves(const Position &position, std::vector<Move> &moves,
+                                     const FrozenSquares &frozen) {
+    enumerateMoves(position, moves);
+    pruneMoves(position, moves, frozen);
+}
+
 void Retractor::retract(Position &position, const Move &move) {
     updatePieces(position, move);
     updateCastling(position, move);
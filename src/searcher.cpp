@@ -1,13 +1,76 @@
+#include <chrono>
+
 #include "move.h"
 #include "position.h"
 #include "progressReporter.h"
 #include "searcher.h"
 
+constexpr int timeCheckPeriod = 1 << 10; // Querying the clock for every node would be wasteful
+
 Searcher::Searcher(void (*positionCallback)(const Position &, const std::vector<Move> &, int fullExaminationDepth),
                    ProgressReporter &reporter) : positionCallback(positionCallback), reporter(reporter) {
     reporter.start();
 }
 
+bool Searcher::isGraphOutput() const {
+    return nodeCallback != nullptr;
+}
+
+void Searcher::startSearch() {
+    solutionCount = 0;
+    examinedNodes = 0;
+    stopped = false;
+    startTime = std::chrono::steady_clock::now();
+}
+
+bool Searcher::limitReached() {
+    ++examinedNodes;
+    if (nodeLimit > 0 && examinedNodes > nodeLimit) {
+        stopped = true;
+    }
+    if (timeLimit > 0.0 && examinedNodes % timeCheckPeriod == 0) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        if (elapsed.count() > timeLimit) {
+            stopped = true;
+        }
+    }
+    return stopped;
+}
+
+long long Searcher::acceptSolutions(long long count) {
+    if (maxSolutions > 0 && solutionCount + count > maxSolutions) {
+        count = maxSolutions - solutionCount;
+        stopped = true;
+    }
+    solutionCount += count;
+    return count;
+}
+
+void Searcher::setGraphCallbacks(void (*nodeCallback)(int id, const Position &, int depth, long long solutionCount,
+                                                      bool starting),
+                                 void (*edgeCallback)(int fromId, int toId, const Move &)) {
+    this->nodeCallback = nodeCallback;
+    this->edgeCallback = edgeCallback;
+}
+
+void Searcher::setCountOnly(bool countOnly) {
+    this->countOnly = countOnly;
+}
+
+long long Searcher::getSolutionCount() const {
+    return solutionCount;
+}
+
+void Searcher::setLimits(long long maxSolutions, double timeLimit, long long nodeLimit) {
+    this->maxSolutions = maxSolutions;
+    this->timeLimit = timeLimit;
+    this->nodeLimit = nodeLimit;
+}
+
+bool Searcher::isComplete() const {
+    return !stopped;
+}
+
 Searcher::~Searcher() {
     reporter.end();
 }
\ No newline at end of file
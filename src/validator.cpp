@@ -1,16 +1,36 @@
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <iterator>
+#include <queue>
+#include <unordered_map>
 #include <vector>
 
 #include "analyzer.h"
 #include "enums.h"
 #include "exceptions.h"
+#include "frozenSquares.h"
 #include "helper.h"
 #include "matchers.h"
+#include "move.h"
+#include "obstructedMoveMaps.h"
 #include "piece.h"
 #include "pieceCounts.h"
 #include "position.h"
 #include "requiredMoveMaps.h"
+#include "square.h"
 #include "validator.h"
 
+constexpr Pieces firstRankPieces[8] = {Rook, Knight, Bishop, Queen, King, Bishop, Knight, Rook};
+constexpr int originCounts[5] = {1, 1, 2, 2, 2}; // Indexed by piece kind
+constexpr int originFiles[5][2] = {{4}, {3}, {0, 7}, {2, 5}, {1, 6}};
+constexpr int anyParity = -1; // A move can be wasted, so both parities are possible
+constexpr int noParity = -2; // The square cannot be reached at all
+constexpr std::size_t parityCacheLimit = 1 << 12;
+constexpr int unreachableTarget = 1 << 20;
+
 void Validator::validateUserKings(const std::vector<Piece> &pieces) {
     bool sawKing = false;
     for (auto &piece : pieces) {
@@ -103,22 +123,18 @@ bool Validator::validateChecks(const Position &position) {
     return !Analyzer::isInCheck(position, Helper::opposite(position.getTurn()));
 }
 
-bool Validator::validateRequiredMoveNumber(const Position &position, Sides side) {
-    if (!position.getFullMoveLog()) {
-        return true;
-    }
-    int completedMoves = position.getCompletedMoves(side);
+int Validator::getRequiredMoves(const Position &position, Sides side) {
     int capturedOpposite = 16 - static_cast<int>(position.getPieces(Helper::opposite(side)).size());
-    if (capturedOpposite > 0 && completedMoves <= capturedOpposite) { // We're using <= instead of < because the first
-        return false;                                                 // move cannot be a capture
-    }
+    int capturesRequired = capturedOpposite > 0 ? capturedOpposite + 1 : 0; // The first move cannot be a capture
+    // The distances are never shorter than the static ones and grow when unmoved pawns are in the way
+    const MoveMaps &maps = ObstructedMoveMaps::get(position, side);
     auto pawn = ZeroMatcher(Pawn, pawnMoveMap);
-    auto king = ZeroMatcher(King, kingMoveMap);
-    auto queen = SingleMatcher(Queen, queenMoveMap, queenPromotedMoveMap);
-    auto leftBishop = SingleMatcher(Bishop, leftBishopMoveMap, leftBishopPromotedMoveMap);
-    auto rightBishop = SingleMatcher(Bishop, rightBishopMoveMap, rightBishopPromotedMoveMap);
-    auto knight = DoubleMatcher(Knight, knightMoveMap, knightPromotedMoveMap);
-    auto rook = DoubleMatcher(Rook, rookMoveMap, rookPromotedMoveMap);
+    auto king = ZeroMatcher(King, maps.king);
+    auto queen = SingleMatcher(Queen, maps.queen, maps.queenPromoted);
+    auto leftBishop = SingleMatcher(Bishop, maps.leftBishop, maps.leftBishopPromoted);
+    auto rightBishop = SingleMatcher(Bishop, maps.rightBishop, maps.rightBishopPromoted);
+    auto knight = DoubleMatcher(Knight, maps.leftKnight, maps.rightKnight, maps.knightPromoted);
+    auto rook = DoubleMatcher(Rook, maps.leftRook, maps.rightRook, maps.rookPromoted);
     for (auto &piece : position.getPieces(side)) {
         pawn.add(piece);
         king.add(piece);
@@ -131,7 +147,327 @@ bool Validator::validateRequiredMoveNumber(const Position &position, Sides side)
     int movesRequired = pawn.count() + king.count() +
                         queen.count() + leftBishop.count() + rightBishop.count() +
                         knight.count() + rook.count();
-    return movesRequired <= completedMoves;
+    return std::max(movesRequired, capturesRequired);
+}
+
+bool Validator::validateRequiredMoveNumber(const Position &position, Sides side) {
+    if (!position.getFullMoveLog()) {
+        return true;
+    }
+    return getRequiredMoves(position, side) <= position.getCompletedMoves(side);
+}
+
+int Validator::getRequiredPlies(const Position &position) {
+    int whiteMoves = getRequiredMoves(position, White);
+    int blackMoves = getRequiredMoves(position, Black);
+    if (position.getTurn() == White) { // Both sides have made the same number of moves
+        return 2 * std::max(whiteMoves, blackMoves);
+    }
+    return std::max(2 * whiteMoves - 1, 2 * blackMoves + 1); // White has made one move more
+}
+
+bool Validator::validatePawnCaptures(const Position &position, Sides side) {
+    int files[8], advances[8];
+    int pawnCount = 0;
+    int occupiedFiles = 0;
+    bool sharedFiles = false;
+    for (auto &piece : position.getPieces(side)) {
+        if (piece.kind == Pawn) {
+            files[pawnCount] = piece.square.file;
+            advances[pawnCount] = side == White ? piece.square.rank - 1 : 6 - piece.square.rank;
+            ++pawnCount;
+            sharedFiles = sharedFiles || (occupiedFiles & (1 << piece.square.file)) != 0;
+            occupiedFiles |= 1 << piece.square.file;
+        }
+    }
+    if (!sharedFiles) { // Every pawn can have stayed on its own file, which is the case for most positions
+        return true;
+    }
+    // Every pawn comes from its own file, and each capture it made shifted it by one file and one rank at most
+    constexpr int impossible = 1 << 10;
+    int captures[1 << 8];
+    std::fill(std::begin(captures), std::end(captures), impossible);
+    captures[0] = 0;
+    int fewestCaptures = impossible;
+    for (int origins = 0; origins < (1 << 8); ++origins) {
+        if (captures[origins] == impossible) {
+            continue;
+        }
+        int pawn = static_cast<int>(std::bitset<8>(origins).count());
+        if (pawn == pawnCount) {
+            fewestCaptures = std::min(fewestCaptures, captures[origins]);
+            continue;
+        }
+        for (int file = 0; file < 8; ++file) {
+            int shift = abs(files[pawn] - file);
+            if ((origins & (1 << file)) == 0 && shift <= advances[pawn]) {
+                int &next = captures[origins | (1 << file)];
+                next = std::min(next, captures[origins] + shift);
+            }
+        }
+    }
+    int capturedOpposite = 16 - static_cast<int>(position.getPieces(Helper::opposite(side)).size());
+    return fewestCaptures <= capturedOpposite;
+}
+
+void Validator::computeMoveParities(Pieces kind, const Square &origin, const FrozenSquares &frozen,
+                                    int (&parities)[8][8]) {
+    for (auto &row : parities) {
+        for (auto &parity : row) {
+            parity = noParity;
+        }
+    }
+    parities[origin.file][origin.rank] = 0;
+    if (frozen.contains(origin)) {
+        return;
+    }
+    // Colours the squares reachable from the origin by the parity of their distance; if two squares of the same colour
+    // are one move apart, a move can be wasted on the way and either parity is possible
+    std::queue<Square> queue;
+    queue.push(origin);
+    bool sliding = kind == Queen || kind == Rook || kind == Bishop;
+    while (!queue.empty()) {
+        Square current = queue.front();
+        queue.pop();
+        int parity = parities[current.file][current.rank];
+        for (int fileDelta = -2; fileDelta <= 2; ++fileDelta) {
+            for (int rankDelta = -2; rankDelta <= 2; ++rankDelta) {
+                bool knightStep = abs(fileDelta * rankDelta) == 2;
+                bool unitStep = abs(fileDelta) <= 1 && abs(rankDelta) <= 1 && (fileDelta != 0 || rankDelta != 0);
+                bool straight = fileDelta == 0 || rankDelta == 0;
+                bool allowed = kind == Knight ? knightStep
+                        : unitStep && (kind == King || kind == Queen || (kind == Rook) == straight);
+                if (!allowed) {
+                    continue;
+                }
+                // Frozen pieces have been in place all along, so no piece could ever get to or through their squares
+                Square next = current.shift(fileDelta, rankDelta);
+                while (next.file >= 0 && next.file < 8 && next.rank >= 0 && next.rank < 8 && !frozen.contains(next)) {
+                    int &nextParity = parities[next.file][next.rank];
+                    if (nextParity == noParity) {
+                        nextParity = 1 - parity;
+                        queue.push(next);
+                    } else if (nextParity == parity) {
+                        for (auto &row : parities) {
+                            for (auto &anyParityCell : row) {
+                                anyParityCell = anyParity;
+                            }
+                        }
+                        return;
+                    }
+                    if (!sliding) {
+                        break;
+                    }
+                    next = next.shift(fileDelta, rankDelta);
+                }
+            }
+        }
+    }
+}
+
+const MoveParities &Validator::getMoveParities(const FrozenSquares &frozen, Sides side) {
+    static std::unordered_map<uint64_t, MoveParities> cache[2];
+    auto cached = cache[side].find(frozen.getMask());
+    if (cached == cache[side].end()) {
+        if (cache[side].size() >= parityCacheLimit) {
+            cache[side].clear();
+        }
+        MoveParities parities = {};
+        int firstRank = side == White ? 0 : 7;
+        for (int file = 0; file < 8; ++file) {
+            computeMoveParities(firstRankPieces[file], Square(file, firstRank), frozen, parities.origins[file]);
+        }
+        cached = cache[side].emplace(frozen.getMask(), parities).first;
+    }
+    return cached->second;
+}
+
+bool Validator::validateMoveParity(const Position &position, Sides side) {
+    // Only applies while no piece of the side is missing and no pawn can have gained a tempo with a double step, so
+    // that the number of moves made by every piece is either fixed or follows from where it stands
+    // Knights always have a parity; kings, rooks, bishops and queens only have one while frozen squares confine them to
+    // squares without an odd cycle of moves, such as a rook boxed in on a1 and b1, and otherwise the check is skipped
+    if (!position.getFullMoveLog() || position.getPieces(side).size() != 16) {
+        return true;
+    }
+    int pawnRank = side == White ? 1 : 6;
+    int moves = 0;
+    Square squares[6][2];
+    int counts[6] = {};
+    for (auto &piece : position.getPieces(side)) {
+        if (piece.kind == Pawn) {
+            int advance = abs(piece.square.rank - pawnRank);
+            if (advance >= 2) {
+                return true;
+            }
+            moves += advance;
+        } else if (counts[piece.kind] < originCounts[piece.kind]) {
+            squares[piece.kind][counts[piece.kind]++] = piece.square;
+        } else {
+            return true;
+        }
+    }
+    const MoveParities &parities = getMoveParities(FrozenSquares(position), side);
+    for (Pieces kind : {King, Queen, Rook, Bishop, Knight}) {
+        int count = originCounts[kind];
+        // The pieces of the same kind may have swapped places, so every assignment to origins has to agree
+        int parity = noParity;
+        for (int swap = 0; swap < count; ++swap) {
+            int assignmentParity = 0;
+            for (int index = 0; index < count && assignmentParity != noParity; ++index) {
+                const Square &square = squares[kind][index];
+                int pieceParity = parities.origins[originFiles[kind][(index + swap) % count]][square.file][square.rank];
+                if (pieceParity == anyParity) {
+                    return true;
+                }
+                assignmentParity = pieceParity == noParity ? noParity : (assignmentParity + pieceParity) % 2;
+            }
+            if (assignmentParity != noParity) {
+                if (parity != noParity && parity != assignmentParity) {
+                    return true;
+                }
+                parity = assignmentParity;
+            }
+        }
+        if (parity == noParity) { // Unreachable squares are left to the required move number check
+            return true;
+        }
+        moves += parity;
+    }
+    return (position.getCompletedMoves(side) - moves) % 2 == 0;
+}
+
+int Validator::getEmptyBoardDistance(Pieces kind, const Square &from, const Square &to) {
+    static int knightDistances[8][8][8][8];
+    static bool knightDistancesComputed = false;
+    if (!knightDistancesComputed) {
+        for (int file = 0; file < 8; ++file) {
+            for (int rank = 0; rank < 8; ++rank) {
+                auto &distances = knightDistances[file][rank];
+                for (auto &row : distances) {
+                    for (auto &distance : row) {
+                        distance = unreachableTarget;
+                    }
+                }
+                std::queue<Square> queue;
+                distances[file][rank] = 0;
+                queue.push(Square(file, rank));
+                while (!queue.empty()) {
+                    Square current = queue.front();
+                    queue.pop();
+                    for (int fileDelta = -2; fileDelta <= 2; ++fileDelta) {
+                        for (int rankDelta = -2; rankDelta <= 2; ++rankDelta) {
+                            Square next = current.shift(fileDelta, rankDelta);
+                            if (abs(fileDelta * rankDelta) == 2 && next.file >= 0 && next.file < 8 && next.rank >= 0
+                                && next.rank < 8 && distances[next.file][next.rank] == unreachableTarget) {
+                                distances[next.file][next.rank] = distances[current.file][current.rank] + 1;
+                                queue.push(next);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        knightDistancesComputed = true;
+    }
+    int fileDistance = abs(from.file - to.file);
+    int rankDistance = abs(from.rank - to.rank);
+    if (fileDistance == 0 && rankDistance == 0) {
+        return 0;
+    }
+    bool straight = fileDistance == 0 || rankDistance == 0;
+    bool diagonal = fileDistance == rankDistance;
+    switch (kind) {
+        case King:
+            return std::max(fileDistance, rankDistance);
+        case Queen:
+            return straight || diagonal ? 1 : 2;
+        case Rook:
+            return straight ? 1 : 2;
+        case Bishop:
+            return diagonal ? 1 : ((fileDistance + rankDistance) % 2 == 0 ? 2 : unreachableTarget);
+        case Knight:
+            return knightDistances[from.file][from.rank][to.file][to.rank];
+        default:
+            return unreachableTarget;
+    }
+}
+
+int Validator::getRequiredMovesTowards(const Position &position, const Position &target, Sides side) {
+    Sides opposite = Helper::opposite(side);
+    int captures = static_cast<int>(position.getPieces(opposite).size() - target.getPieces(opposite).size());
+    if (captures < 0) {
+        return unreachableTarget;
+    }
+    // Every pawn of the target comes from a pawn that is not farther advanced. Matching the most advanced ones first
+    // minimizes the advances, with pawns on their initial rank counted as if a double step had been made already
+    std::vector<int> ranks, targetRanks;
+    for (auto &piece : position.getPieces(side)) {
+        if (piece.kind == Pawn) {
+            ranks.emplace_back(side == White ? piece.square.rank : 7 - piece.square.rank);
+        }
+    }
+    for (auto &piece : target.getPieces(side)) {
+        if (piece.kind == Pawn) {
+            targetRanks.emplace_back(side == White ? piece.square.rank : 7 - piece.square.rank);
+        }
+    }
+    if (targetRanks.size() > ranks.size()) {
+        return unreachableTarget;
+    }
+    std::sort(ranks.rbegin(), ranks.rend());
+    std::sort(targetRanks.rbegin(), targetRanks.rend());
+    std::vector<bool> used(ranks.size(), false);
+    int pawnMoves = 0;
+    for (int targetRank : targetRanks) {
+        std::size_t index = 0;
+        while (index < ranks.size() && (used[index] || ranks[index] > targetRank)) {
+            ++index;
+        }
+        if (index == ranks.size()) {
+            return unreachableTarget;
+        }
+        used[index] = true;
+        pawnMoves += std::max(0, targetRank - std::max(ranks[index], 2));
+    }
+    // Pieces the target has in excess have to be promoted from the pawns left over
+    const PieceCounts &counts = position.getPieceCounts(side);
+    const PieceCounts &targetCounts = target.getPieceCounts(side);
+    int promotions = std::max(0, targetCounts.queen - counts.queen) + std::max(0, targetCounts.rook - counts.rook)
+                     + std::max(0, targetCounts.whiteSquareBishop - counts.whiteSquareBishop)
+                     + std::max(0, targetCounts.blackSquareBishop - counts.blackSquareBishop)
+                     + std::max(0, targetCounts.knight - counts.knight);
+    if (promotions > static_cast<int>(ranks.size() - targetRanks.size())) {
+        return unreachableTarget;
+    }
+    // Every piece of the target needs at least as many moves as the closest piece of its kind in the position would
+    // need on an empty board, or a single one if it can be promoted. Castling saves a move for the king and the rook
+    bool promotable = static_cast<int>(ranks.size() - targetRanks.size()) > 0;
+    int pieceMoves = 0;
+    for (auto &targetPiece : target.getPieces(side)) {
+        if (targetPiece.kind == Pawn) {
+            continue;
+        }
+        int fewestMoves = promotable && targetPiece.kind != King ? 1 : unreachableTarget;
+        for (auto &piece : position.getPieces(side)) {
+            if (piece.kind == targetPiece.kind) {
+                int moves = getEmptyBoardDistance(piece.kind, piece.square, targetPiece.square);
+                fewestMoves = std::min(fewestMoves, moves);
+            }
+        }
+        pieceMoves += fewestMoves;
+    }
+    if (position.getCastling(side, Kingside) != False || position.getCastling(side, Queenside) != False) {
+        pieceMoves = std::max(0, pieceMoves - 2);
+    }
+    return std::max(captures, pawnMoves + pieceMoves);
+}
+
+bool Validator::validateTargetDistance(const Position &position, const Position &target) {
+    int plies = target.getPlyCounter() - position.getPlyCounter();
+    Sides turn = position.getTurn();
+    return getRequiredMovesTowards(position, target, turn) <= (plies + 1) / 2
+           && getRequiredMovesTowards(position, target, Helper::opposite(turn)) <= plies / 2;
 }
 
 bool Validator::validateInitial(const Position &position) {
@@ -139,13 +475,92 @@ bool Validator::validateInitial(const Position &position) {
            || Analyzer::canBeStarting(position);
 }
 
-bool Validator::validate(const Position &position) {
-    return validateChecks(position)
-           && validateCounts(position.getPieceCounts(White)) && validateCounts(position.getPieceCounts(Black))
+bool Validator::validateExceptChecks(const Position &position) {
+    return validateCounts(position.getPieceCounts(White)) && validateCounts(position.getPieceCounts(Black))
+           && validatePawnCaptures(position, White) && validatePawnCaptures(position, Black)
            && validateRequiredMoveNumber(position, White) && validateRequiredMoveNumber(position, Black)
+           && validateMoveParity(position, White) && validateMoveParity(position, Black)
            && validateInitial(position);
 }
 
+bool Validator::validate(const Position &position) {
+    return validateChecks(position) && validateExceptChecks(position);
+}
+
+bool Validator::isKingExposedByRetraction(const Position &position, const Move &move) {
+    Sides side = move.side;
+    const Square &kingSquare = position.getKing(Helper::opposite(side)).square;
+    bool promotion = move.type == Promotion || move.type == PromotionWithCapture;
+    bool capture = move.type == Capture || move.type == PromotionWithCapture;
+    Piece retracted = Piece(promotion ? Pawn : move.piece, side, move.startingSquare);
+    if (retracted.kind == King || retracted.kind == Knight || retracted.kind == Pawn) {
+        if (Analyzer::isAttacking(position, retracted, kingSquare)) {
+            return true;
+        }
+    }
+    // Only the lines through the two squares changed by the move can open or get a new slider
+    for (const Square *square : {&move.startingSquare, &move.targetSquare}) {
+        int fileDelta = square->file - kingSquare.file;
+        int rankDelta = square->rank - kingSquare.rank;
+        bool straight = fileDelta == 0 || rankDelta == 0;
+        if (!straight && abs(fileDelta) != abs(rankDelta)) {
+            continue;
+        }
+        int fileStep = Helper::sgn(fileDelta);
+        int rankStep = Helper::sgn(rankDelta);
+        for (Square current = kingSquare.shift(fileStep, rankStep); position.isOnBoard(current);
+             current = current.shift(fileStep, rankStep)) {
+            Piece piece;
+            if (current == move.startingSquare) {
+                piece = retracted;
+            } else if (current == move.targetSquare) {
+                if (capture) { // The uncaptured piece belongs to the king's side
+                    break;
+                }
+                continue;
+            } else if (position.getSquareInfo(current).occupied) {
+                piece = position.getPiece(position.getSquareInfo(current));
+            } else {
+                continue;
+            }
+            bool slides = piece.kind == Queen || piece.kind == (straight ? Rook : Bishop);
+            if (piece.side == side && slides) {
+                return true;
+            }
+            break;
+        }
+    }
+    return false;
+}
+
+bool Validator::validateRetraction(const Position &position, const Move &move) {
+    Sides opposite = Helper::opposite(move.side);
+    if (move.type == Promotion || move.type == PromotionWithCapture) {
+        PieceCounts counts = position.getPieceCounts(move.side);
+        Position::updateCounts(counts, Piece(move.promotedPiece, move.side, move.targetSquare), false);
+        Position::updateCounts(counts, Piece(Pawn, move.side, move.startingSquare));
+        if (!validateCounts(counts)) {
+            return false;
+        }
+    }
+    if (move.type == Capture || move.type == PromotionWithCapture || move.type == EnPassant) {
+        PieceCounts counts = position.getPieceCounts(opposite);
+        Position::updateCounts(counts, Piece(move.capturedPiece, opposite, move.targetSquare));
+        if (!validateCounts(counts)) {
+            return false;
+        }
+    }
+    switch (move.type) {
+        case SimpleMove:
+        case Capture:
+        case Promotion:
+        case PromotionWithCapture:
+            return !isKingExposedByRetraction(position, move);
+        default: // Castling and en passant are rare enough to be left for the full validation
+            return true;
+    }
+}
+
 std::pair<bool, std::string> Validator::validateAndStrictenUserPosition(Position &position) {
     for (auto &side : {White, Black}) {
         std::string sideString = Helper::sideToString(side, true);
@@ -216,5 +631,17 @@ std::pair<bool, std::string> Validator::validateAndStrictenUserPosition(Position
         return {false, e.what()};
     }
 
+    return {true, ""};
+}
+
+std::pair<bool, std::string> Validator::applyPliesPlayed(Position &position, int pliesPlayed) {
+    if ((pliesPlayed % 2 == 1) != (position.getTurn() == Black)) {
+        return {false, "The number of plies played contradicts the side to move"};
+    }
+    int fullMoves = pliesPlayed / 2 + 1;
+    if (position.getFullMoveLog() && position.getFullMoveCounter() != fullMoves) {
+        return {false, "The number of plies played contradicts the move counter"};
+    }
+    position.setFullMoves(true, fullMoves);
     return {true, ""};
 }
\ No newline at end of file
@@ -0,0 +1,7 @@
+# Runs Chass on a single position and checks its exit code
+execute_process(COMMAND ${CMAKE_COMMAND} -E echo ${POSITION}
+                COMMAND ${CHASS} ${ARGUMENTS}
+                OUTPUT_QUIET ERROR_QUIET RESULT_VARIABLE result)
+if (NOT result EQUAL EXPECTED)
+    message(FATAL_ERROR "Exit code ${result} instead of ${EXPECTED}")
+endif ()
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "analyzer.h"
 #include "exceptions.h"
 #include "FENParser.h"
+#include "frozenSquares.h"
 #include "retractor.h"
 #include "validator.h"
 
@@ -37,6 +38,20 @@ Position copyOrWeaken(const Position &position, bool weaken) {
     }
 }
 
+void enumeratePrunedRetractions(const Position &position, std::vector<Move> &moves) {
+    Retractor::enumeratePrunedMoves(position, moves, FrozenSquares(position));
+}
+
+bool checkFrozenSquares(const Position &final, const std::vector<Move> &moves) {
+    FrozenSquares frozen(final);
+    for (auto &move : moves) {
+        if (!frozen.allowsAdvance(move) || !frozen.allowsRetraction(move)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool checkMoveProcessing(const Position &from, const Position &to, const Move &move, bool weaken,
                          void (*enumerate)(const Position &, std::vector<Move> &),
                          void (*perform)(Position &, const Move &), bool onlyComparePlacement = false) {
@@ -99,6 +114,7 @@ bool checkValidationForFalseNegatives(const Position &nonweakened, bool weaken)
 
 bool process(const std::string &game) {
     Position current = Analyzer::getStartingPosition();
+    std::vector<Move> moves;
     int cursor = 0;
     std::string notation;
     while (readMove(game, cursor, notation)) {
@@ -108,6 +124,7 @@ bool process(const std::string &game) {
             check = check || mate;
             Position previous = current;
             Advancer::advance(current, move);
+            moves.emplace_back(move);
             if (mate != Analyzer::isCheckmated(current)) {
                 return false;
             }
@@ -119,6 +136,8 @@ bool process(const std::string &game) {
             }
             if (!checkMoveProcessing(current, previous, move, false, Retractor::enumerateMoves, Retractor::retract)
                 || !checkMoveProcessing(current, previous, move, true, Retractor::enumerateMoves, Retractor::retract)
+                || !checkMoveProcessing(current, previous, move, false, enumeratePrunedRetractions, Retractor::retract)
+                || !checkMoveProcessing(current, previous, move, true, enumeratePrunedRetractions, Retractor::retract)
                 || !checkMoveProcessing(previous, current, move, true, Advancer::enumerateMoves, Advancer::advance)) {
                 // Non-weakened forward processing has been implicitly checked via interpretShortAlgebraic
                 return false;
@@ -131,7 +150,7 @@ bool process(const std::string &game) {
             return false;
         }
     }
-    return true;
+    return checkFrozenSquares(current, moves) && checkFrozenSquares(copyOrWeaken(current, true), moves);
 }
 
 int main() {
@@ -1,40 +1,334 @@
+#include <cmath>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <string>
+#include <tuple>
+#include <vector>
 
+#include "advancer.h"
+#include "ancestorCollector.h"
 #include "backtracker.h"
+#include "bitboardBatch.h"
 #include "FENParser.h"
 #include "meeterInTheMiddle.h"
+#include "planner.h"
 #include "progressReporter.h"
+#include "proofGameSolver.h"
+#include "retractor.h"
 #include "validator.h"
 
-int counter;
+long long counter;
+long long ancestorPaths;
+int expiredSearches; // Stopped by the time limit
+std::vector<long long> targetStarts; // The solution counter at every target header of a batch
+constexpr double cappedMemory = 1 << 16; // Small enough for the capped search to switch to depth-first retraction
+constexpr int cappedMaxDepth = 8; // The depth-first retraction is too slow for the longer games
+constexpr double generousTime = 1e6; // In seconds
+constexpr double expiredTime = 1e-9; // In seconds
+constexpr int batchTargetsDepth = 2;
+constexpr int bitboardsDepth = 2; // The moves both ways from the retractions of every problem up to this depth
+constexpr int shortestUnknownCounterDepth = 6; // Longer than every shortest game tried without the move counter
+constexpr int ancestorsMaxDepth = 6; // Every depth up to the given one is backtracked again
+// Relative; the sampling is seeded, so the estimates are the same on every run and are at most 10% off for now
+constexpr double estimateTolerance = 0.2;
 
 void output(const Position &position, const std::vector<Move> &moves, int fullExaminationDepth) {
     ++counter;
 }
 
-bool process(const Position &position, int fullExaminationDepth, int proofExtraDepth, int answerCount) {
+void outputTarget(std::size_t, const Position &) {
+    targetStarts.push_back(counter);
+}
+
+void outputAncestor(const Position &, long long pathCount) {
+    ancestorPaths += pathCount;
+}
+
+void outputNode(int, const Position &, int depth, long long solutionCount, bool) {
+    if (depth == 0) {
+        counter = solutionCount;
+    }
+}
+
+void outputEdge(int, int, const Move &) {}
+
+bool process(const Position &position, int fullExaminationDepth, int proofExtraDepth, int answerCount,
+             bool graphOutput, bool countOnly, bool lazyUncaptures) {
     counter = 0;
     ProgressReporter reporter(nullptr);
     if (proofExtraDepth == 0 && fullExaminationDepth > 1
         && position.getFullMoveLog() && position.getPlyCounter() == fullExaminationDepth + 1) {
         MeeterInTheMiddle meeterInTheMiddle(output, reporter);
+        if (graphOutput) {
+            meeterInTheMiddle.setGraphCallbacks(outputNode, outputEdge);
+        }
+        meeterInTheMiddle.setCountOnly(countOnly);
         meeterInTheMiddle.search(position, fullExaminationDepth);
+        if (countOnly) {
+            counter = meeterInTheMiddle.getSolutionCount();
+        }
     } else {
         Backtracker backtracker(output, reporter);
+        if (graphOutput) {
+            backtracker.setGraphCallbacks(outputNode, outputEdge);
+        }
+        backtracker.setCountOnly(countOnly);
+        backtracker.setLazyUncaptures(lazyUncaptures);
         backtracker.search(position, fullExaminationDepth, fullExaminationDepth + proofExtraDepth);
+        if (countOnly) {
+            counter = backtracker.getSolutionCount();
+        }
     }
     return counter == answerCount;
 }
 
+std::pair<long long, bool> searchLimited(const Position &position, int fullExaminationDepth, int proofExtraDepth,
+                                         long long maxSolutions, double timeLimit, long long nodeLimit) {
+    // Returns the number of solutions found and whether the search was complete
+    ProgressReporter reporter(nullptr);
+    if (proofExtraDepth == 0 && fullExaminationDepth > 1
+        && position.getFullMoveLog() && position.getPlyCounter() == fullExaminationDepth + 1) {
+        MeeterInTheMiddle meeterInTheMiddle(output, reporter);
+        meeterInTheMiddle.setCountOnly(true);
+        meeterInTheMiddle.setLimits(maxSolutions, timeLimit, nodeLimit);
+        meeterInTheMiddle.search(position, fullExaminationDepth);
+        return {meeterInTheMiddle.getSolutionCount(), meeterInTheMiddle.isComplete()};
+    }
+    Backtracker backtracker(output, reporter);
+    backtracker.setCountOnly(true);
+    backtracker.setLimits(maxSolutions, timeLimit, nodeLimit);
+    backtracker.search(position, fullExaminationDepth, fullExaminationDepth + proofExtraDepth);
+    return {backtracker.getSolutionCount(), backtracker.isComplete()};
+}
+
+bool processLimits(const Position &position, int fullExaminationDepth, int proofExtraDepth, int answerCount) {
+    // A solution limit only stops the search once one more solution turns up, so exactly as many solutions as
+    // allowed still make a complete search
+    auto exact = searchLimited(position, fullExaminationDepth, proofExtraDepth, answerCount, 0.0, 0);
+    if (exact.first != answerCount || !exact.second) {
+        return false;
+    }
+    if (answerCount > 1) {
+        auto fewer = searchLimited(position, fullExaminationDepth, proofExtraDepth, answerCount - 1, 0.0, 0);
+        if (fewer.first != answerCount - 1 || fewer.second) {
+            return false;
+        }
+    }
+    auto generous = searchLimited(position, fullExaminationDepth, proofExtraDepth, 0, generousTime, 0);
+    if (generous.first != answerCount || !generous.second) {
+        return false;
+    }
+    // Retracting to a solution takes examining more than one position, while a hopeless one may be rejected at once
+    auto single = searchLimited(position, fullExaminationDepth, proofExtraDepth, 0, 0.0, 1);
+    if (single.first > answerCount || (answerCount > 0 && fullExaminationDepth > 0 && single.second)) {
+        return false;
+    }
+    // The clock is only queried once in a while, and how many positions meeting in the middle examines depends on
+    // timings, so a small search may finish in time; the larger ones are counted to make sure some are stopped
+    auto expired = searchLimited(position, fullExaminationDepth, proofExtraDepth, 0, expiredTime, 0);
+    if (expired.first > answerCount || (expired.second && expired.first != answerCount)) {
+        return false;
+    }
+    expiredSearches += expired.second ? 0 : 1;
+    return true;
+}
+
+bool processCapped(const Position &position, int fullExaminationDepth, int answerCount, bool countOnly) {
+    counter = 0;
+    ProgressReporter reporter(nullptr);
+    MeeterInTheMiddle meeterInTheMiddle(output, reporter);
+    meeterInTheMiddle.setCountOnly(countOnly);
+    meeterInTheMiddle.setMemoryLimit(cappedMemory);
+    meeterInTheMiddle.search(position, fullExaminationDepth);
+    return meeterInTheMiddle.getSolutionCount() == answerCount && (countOnly || counter == answerCount);
+}
+
+bool processCompressed(const Position &position, int fullExaminationDepth, int answerCount, bool countOnly) {
+    counter = 0;
+    ProgressReporter reporter(nullptr);
+    MeeterInTheMiddle meeterInTheMiddle(output, reporter);
+    meeterInTheMiddle.setCountOnly(countOnly);
+    meeterInTheMiddle.setCompressLevels(true);
+    meeterInTheMiddle.search(position, fullExaminationDepth);
+    return meeterInTheMiddle.getSolutionCount() == answerCount && (countOnly || counter == answerCount);
+}
+
+bool processPliesPlayed(const std::string &line, int fullExaminationDepth, int answerCount) {
+    // The move counter is dropped and then restored from the number of plies played, as with the -n option
+    std::string known = line;
+    Position withCounter = FENParser::parse(known);
+    std::string unknown = line.substr(0, line.rfind(' ')) + " ?";
+    Position contradicting = FENParser::parse(unknown);
+    Position position = FENParser::parse(unknown);
+    if (Validator::applyPliesPlayed(withCounter, fullExaminationDepth + 2).first
+        || Validator::applyPliesPlayed(contradicting, fullExaminationDepth + 1).first
+        || !Validator::applyPliesPlayed(position, fullExaminationDepth).first
+        || position.getPlyCounter() != fullExaminationDepth + 1) {
+        return false;
+    }
+    Validator::validateAndStrictenUserPosition(position);
+    return process(position, fullExaminationDepth, 0, answerCount, false, true, false);
+}
+
+bool processAncestors(const Position &position, int fullExaminationDepth) {
+    // Every sequence of retractions ends in exactly one distinct ancestor, so the paths add up to the number of
+    // sequences counted by backtracking without any proof extension
+    for (int depth = 1; depth <= fullExaminationDepth; ++depth) {
+        ancestorPaths = 0;
+        ProgressReporter reporter(nullptr);
+        AncestorCollector ancestorCollector(outputAncestor, reporter);
+        ancestorCollector.search(position, depth);
+        Backtracker backtracker(output, reporter);
+        backtracker.setCountOnly(true);
+        backtracker.search(position, depth, depth);
+        if (ancestorPaths != backtracker.getSolutionCount()
+            || ancestorCollector.getSolutionCount() > backtracker.getSolutionCount()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool processEstimate(const Position &position, int fullExaminationDepth) {
+    // Without transpositions, the tree backtracked to every depth is as large as the number of sequences found there
+    double treeSize = 1.0;
+    for (int depth = 1; depth <= fullExaminationDepth; ++depth) {
+        ProgressReporter reporter(nullptr);
+        Backtracker backtracker(output, reporter);
+        backtracker.setCountOnly(true);
+        backtracker.search(position, depth, depth);
+        treeSize += static_cast<double>(backtracker.getSolutionCount());
+    }
+    Plan plan = Planner::plan(position, fullExaminationDepth, 0, true, 0.0);
+    return std::abs(plan.backtrackingNodes - treeSize) <= estimateTolerance * treeSize;
+}
+
+bool processBitboards(const Position &position) {
+    // Moves are not validated, so that plenty of children have the wrong king in check
+    std::vector<Position> parents = {position};
+    for (int depth = 0; depth < bitboardsDepth; ++depth) {
+        std::vector<Position> nextParents;
+        for (const auto &parent : parents) {
+            for (bool forward : {false, true}) {
+                std::vector<Move> moves;
+                if (forward) {
+                    Advancer::enumerateMoves(parent, moves);
+                } else {
+                    Retractor::enumerateMoves(parent, moves);
+                }
+                std::vector<Position> children(moves.size(), parent);
+                for (std::size_t index = 0; index < moves.size(); ++index) {
+                    if (forward) {
+                        Advancer::advance(children[index], moves[index]);
+                    } else {
+                        Retractor::retract(children[index], moves[index]);
+                    }
+                }
+                BitboardBatch laidOut, updated;
+                laidOut.assign(children);
+                updated.assignChildren(parent, moves, children);
+                std::vector<bool> results[4];
+                laidOut.findExposedKings(results[0], true);
+                laidOut.findExposedKings(results[1], false);
+                updated.findExposedKings(results[2], true);
+                updated.findExposedKings(results[3], false);
+                for (std::size_t index = 0; index < children.size(); ++index) {
+                    for (const auto &exposed : results) {
+                        if (exposed[index] == Validator::validateChecks(children[index])) {
+                            return false;
+                        }
+                    }
+                }
+                if (!forward) {
+                    nextParents.insert(nextParents.end(), children.begin(), children.end());
+                }
+            }
+        }
+        parents = nextParents;
+    }
+    return true;
+}
+
+bool processShortest(const Position &position, int fullExaminationDepth, int answerCount) {
+    // With the move counter known, the shortest games are exactly the ones found by meeting in the middle
+    ProgressReporter reporter(nullptr);
+    ProofGameSolver proofGameSolver(output, reporter);
+    proofGameSolver.setCountOnly(true);
+    proofGameSolver.search(position, fullExaminationDepth);
+    return proofGameSolver.getSolutionCount() == answerCount
+           && proofGameSolver.getShortestLength() == (answerCount > 0 ? fullExaminationDepth : -1);
+}
+
+bool processShortestUnknownCounter() {
+    // Without the move counter the games of every length up to the maximum one have to be tried
+    const std::vector<std::tuple<std::string, int, int>> cases = {
+            {"r1bqkb1r/pppppppp/2n2n2/8/8/2N2N2/PPPPPPPP/R1BQKB1R w ? ? ? ?", 4, 4},
+            {"rnbqkb1r/pppppppp/5n2/8/8/5N2/PPPPPPPP/RNBQKB1R w ? ? ? ?", 2, 1},
+            {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR b ? ? ? ?", -1, 0}
+    };
+    for (auto [fen, shortestLength, solutionCount] : cases) {
+        Position position = FENParser::parse(fen);
+        Validator::validateAndStrictenUserPosition(position);
+        ProgressReporter reporter(nullptr);
+        ProofGameSolver proofGameSolver(output, reporter);
+        proofGameSolver.setCountOnly(true);
+        proofGameSolver.search(position, shortestUnknownCounterDepth);
+        if (proofGameSolver.getShortestLength() != shortestLength
+            || proofGameSolver.getSolutionCount() != solutionCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool processBatch(const std::vector<Position> &positions, int fullExaminationDepth,
+                  const std::vector<long long> &answerCounts) {
+    ProgressReporter reporter(nullptr);
+    MeeterInTheMiddle meeterInTheMiddle(output, reporter);
+    meeterInTheMiddle.setCountOnly(true);
+    meeterInTheMiddle.searchBatch(positions, fullExaminationDepth);
+    return meeterInTheMiddle.getBatchSolutionCounts() == answerCounts;
+}
+
+bool processBatchTargets() {
+    // Every target gets its header before its solutions, even if it has none
+    std::vector<std::string> lines = {"rnbqkb1r/pppppppp/5n2/8/8/5N2/PPPPPPPP/RNBQKB1R w ? ? 2 2",
+                                      "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w ? ? ? 2"};
+    const std::vector<long long> answerCounts = {1, 0};
+    std::vector<Position> positions;
+    for (auto &line : lines) {
+        positions.emplace_back(FENParser::parse(line));
+        Validator::validateAndStrictenUserPosition(positions.back());
+    }
+    counter = 0;
+    targetStarts.clear();
+    ProgressReporter reporter(nullptr);
+    MeeterInTheMiddle meeterInTheMiddle(output, reporter);
+    meeterInTheMiddle.searchBatch(positions, batchTargetsDepth, outputTarget);
+    if (targetStarts.size() != positions.size() || meeterInTheMiddle.getBatchSolutionCounts() != answerCounts) {
+        return false;
+    }
+    targetStarts.push_back(counter);
+    for (std::size_t target = 0; target < positions.size(); ++target) {
+        if (targetStarts[target + 1] - targetStarts[target] != answerCounts[target]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 int main() {
-    bool passed = true;
+    bool passed = processShortestUnknownCounter() && processBatchTargets();
+    if (!BitboardBatch::isVectorized()) {
+        std::cout << "The vectorized kernels are not supported, so only the scalar ones are tested" << std::endl;
+    }
     std::ifstream input;
     input.open("data/problems.txt");
     int current = 0;
+    std::map<int, std::pair<std::vector<Position>, std::vector<long long>>> batches; // Problems sharing the depth
     while (!input.eof()) {
         std::string line, params, answers, separator;
         std::getline(input, line);
@@ -47,13 +341,39 @@ int main() {
         int answerCount;
         std::istringstream(answers) >> answerCount;
         std::getline(input, separator);
-        if (!process(position, fullExaminationDepth, proofExtraDepth, answerCount)) {
+        bool fullGame = proofExtraDepth == 0 && position.getFullMoveLog()
+                        && position.getPlyCounter() == fullExaminationDepth + 1;
+        if (!processBitboards(position)
+            || !process(position, fullExaminationDepth, proofExtraDepth, answerCount, false, false, false)
+            || !process(position, fullExaminationDepth, proofExtraDepth, answerCount, true, false, false)
+            || !process(position, fullExaminationDepth, proofExtraDepth, answerCount, false, true, false)
+            || !process(position, fullExaminationDepth, proofExtraDepth, answerCount, false, false, true)
+            || !processLimits(position, fullExaminationDepth, proofExtraDepth, answerCount)
+            || (fullGame && !processShortest(position, fullExaminationDepth, answerCount))
+            || (proofExtraDepth == 0 && fullExaminationDepth <= ancestorsMaxDepth
+                && (!processAncestors(position, fullExaminationDepth)
+                    || !processEstimate(position, fullExaminationDepth)))
+            || (fullGame && !processPliesPlayed(line, fullExaminationDepth, answerCount))
+            || (fullGame && (!processCompressed(position, fullExaminationDepth, answerCount, false)
+                             || !processCompressed(position, fullExaminationDepth, answerCount, true)))
+            || (fullGame && fullExaminationDepth <= cappedMaxDepth
+                && (!processCapped(position, fullExaminationDepth, answerCount, false)
+                    || !processCapped(position, fullExaminationDepth, answerCount, true)))) {
             passed = false;
             break;
         }
+        if (fullGame) {
+            batches[fullExaminationDepth].first.emplace_back(position);
+            batches[fullExaminationDepth].second.emplace_back(answerCount);
+        }
         ++current;
         std::cout << "Processed problem " + std::to_string(current) << std::endl;
     }
     input.close();
-    return passed ? 0 : 1;
+    for (auto &batch : batches) {
+        if (passed && !processBatch(batch.second.first, batch.first, batch.second.second)) {
+            passed = false;
+        }
+    }
+    return passed && expiredSearches > 0 ? 0 : 1;
 }
\ No newline at end of file